@@ -41,6 +41,16 @@ typedef enum {
 /* TX and RX buffer size */
 #define I2C_DATA_LENGTH             (1024U + 8U)
 
+/* Latency entries: all comms commands, then flash commands 0x00 to 0x0F */
+#define I2C_LATENCY_TYPES           (17U)
+
+/*! Time from receiving a command to its response being ready */
+typedef struct {
+    uint32_t    count;
+    uint32_t    total_us;
+    uint32_t    max_us;
+} i2c_cmd_latency_t;
+
 void i2c_initialize(void);
 void i2c_deinitialize(void);
 i2c_status_t i2c_registerWriteCallback(i2cCallback_t writeCallback, uint8_t slaveAddress);
@@ -53,5 +63,7 @@ void i2c_fillBufferHead(uint8_t data);
 bool i2c_canSleep(void);
 /* This functions needs to be called at a 30ms interval. */
 void i2c_30ms_tick(void);
+/* Latency of a command type, NULL if it is not tracked. Always NULL on the KL27Z. */
+const i2c_cmd_latency_t* i2c_getCmdLatency(uint8_t slaveAddress, uint8_t cmdId);
 
 #endif /* I2C_H_ */
@@ -245,6 +245,19 @@ static void i2c_write_flash_callback(uint8_t* pData, uint8_t size) {
             }
         }
         break;
+        case gFlashDataSync_c:
+            /* Program any buffered data, reply with the write statistics */
+            if (storage_flush() == STORAGE_SUCCESS) {
+                const storage_cache_stats_t *stats = storage_get_cache_stats();
+                uint32_t tempWrites = __REV(stats->writes);
+                uint32_t tempFlushes = __REV(stats->flushes);
+                i2c_fillBufferHead(pI2cCommand->cmdId);
+                i2c_fillBuffer((uint8_t*) &tempWrites, 1, sizeof(tempWrites));
+                i2c_fillBuffer((uint8_t*) &tempFlushes, 5, sizeof(tempFlushes));
+            } else {
+                i2c_fillBufferHead(gFlashError_c);
+            }
+        break;
         case gFlashCfgFileName_c:
              if (size == 1) {
                 /* If size is 1 (only cmd id), this means it's a read */
@@ -134,6 +134,7 @@ typedef enum flashCmdId_tag {
     gFlashDataRead_c        = 0x0A,
     gFlashDataWrite_c       = 0x0B,
     gFlashDataErase_c       = 0x0C,
+    gFlashDataSync_c        = 0x0D,
     gFlashError_c           = 0x20
 } flashCmdId_t;
 
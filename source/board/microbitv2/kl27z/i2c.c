@@ -291,3 +291,9 @@ void i2c_30ms_tick()
         i2c_wake_timeout--;
     }
 }
+
+const i2c_cmd_latency_t* i2c_getCmdLatency(uint8_t slaveAddress, uint8_t cmdId)
+{
+    // Not collected on the KL27Z
+    return NULL;
+}
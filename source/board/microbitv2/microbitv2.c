@@ -21,6 +21,8 @@
  * limitations under the License.
  */
 
+#include <string.h>
+
 #include "IO_Config.h"
 #include "DAP.h"
 #include "target_family.h"
@@ -30,8 +32,10 @@
 #include "flash_manager.h"
 #include "virtual_fs.h"
 #include "vfs_manager.h"
+#include "vfs_user.h"
 #include "device.h"
 #include "main_interface.h"
+#include "util.h"
 
 #include "microbitv2.h"
 #include "pwm.h"
@@ -205,9 +209,29 @@ void handle_reset_button()
     }
 }
 
+// Commands timed so far, 0 where latency is not collected
+static uint32_t i2c_latency_count(void)
+{
+    const i2c_cmd_latency_t *latency;
+    uint32_t count = 0;
+    uint8_t cmd;
+
+    latency = i2c_getCmdLatency(I2C_SLAVE_NRF_KL_COMMS, 0);
+    if (latency == NULL) {
+        return 0;
+    }
+    count += latency->count;
+    for (cmd = gFlashCfgFileName_c; cmd <= gFlashDataSync_c; cmd++) {
+        count += i2c_getCmdLatency(I2C_SLAVE_FLASH, cmd)->count;
+    }
+    return count;
+}
+
 void board_30ms_hook()
 {
   static uint8_t blink_in_progress = 0;
+  static uint32_t details_latency_count = 0;
+  uint32_t latency_count;
 
     if (usb_state == USB_CONNECTED) {
         // configure pin as GPIO
@@ -230,6 +254,14 @@ void board_30ms_hook()
     }
 
     i2c_30ms_tick();
+    storage_30ms_tick();
+
+    // The latencies in DETAILS.TXT changed
+    latency_count = i2c_latency_count();
+    if (latency_count != details_latency_count) {
+        details_latency_count = latency_count;
+        vfs_user_details_changed();
+    }
 
     // Enter light sleep if USB is not enumerated and main_shutdown_state is idle
     if (usb_state == USB_DISCONNECTED && !usb_pc_connected && main_shutdown_state == MAIN_SHUTDOWN_WAITING
@@ -330,6 +362,9 @@ void board_30ms_hook()
 
 void board_handle_powerdown()
 {
+    // Buffered storage writes would be lost in power down
+    storage_flush();
+
     switch(interface_power_mode){
         case MB_POWER_SLEEP:
             power_sleep();
@@ -410,40 +445,130 @@ void vfs_user_build_filesystem_hook() {
     }
 }
 
+// Writes " <name>=<avg>/<max>", fixed width so the file size does not change
+static uint32_t latency_in_region(uint8_t *buf, uint32_t size, uint32_t start, uint32_t pos,
+                                  const char *name, const i2c_cmd_latency_t *latency)
+{
+    char number[15] = { '=' };
+    uint32_t avg_us = (latency->count > 0) ? (latency->total_us / latency->count) : 0;
+    uint32_t l;
+
+    util_write_uint32_zp(number + 1, MIN(avg_us, 999999), 6);
+    number[7] = '/';
+    util_write_uint32_zp(number + 8, MIN(latency->max_us, 999999), 6);
+    number[14] = 0;
+    l = util_write_in_region(buf, size, start, pos, " ", 1);
+    l += util_write_string_in_region(buf, size, start, pos + l, name);
+    l += util_write_string_in_region(buf, size, start, pos + l, number);
+    return l;
+}
+
+uint32_t vfs_user_details_hook(uint8_t *buf, uint32_t size, uint32_t start, uint32_t pos)
+{
+    const i2c_cmd_latency_t *latency;
+    uint32_t l;
+    uint8_t cmd;
+
+    // Only collected on the nRF52820
+    latency = i2c_getCmdLatency(I2C_SLAVE_NRF_KL_COMMS, 0);
+    if (latency == NULL) {
+        return 0;
+    }
+
+    // Time from receiving an I2C command to its response being ready
+    l = util_write_string_in_region(buf, size, start, pos, "I2C latency avg/max (us):");
+    l += latency_in_region(buf, size, start, pos + l, "comms", latency);
+    for (cmd = gFlashCfgFileName_c; cmd <= gFlashDataSync_c; cmd++) {
+        char name[8] = { 'f', 'l', 'a', 's', 'h' };
+        util_write_hex8(name + 5, cmd);
+        name[7] = 0;
+        latency = i2c_getCmdLatency(I2C_SLAVE_FLASH, cmd);
+        l += latency_in_region(buf, size, start, pos + l, name, latency);
+    }
+    l += util_write_in_region(buf, size, start, pos + l, "\r\n", 2);
+    return l;
+}
+
+// ASCII hex encoding of every byte value, high nibble first
+#define HEX_ROW(h) \
+    {h, '0'}, {h, '1'}, {h, '2'}, {h, '3'}, {h, '4'}, {h, '5'}, {h, '6'}, {h, '7'}, \
+    {h, '8'}, {h, '9'}, {h, 'A'}, {h, 'B'}, {h, 'C'}, {h, 'D'}, {h, 'E'}, {h, 'F'}
+
+static const char hex_table[256][2] = {
+    HEX_ROW('0'), HEX_ROW('1'), HEX_ROW('2'), HEX_ROW('3'),
+    HEX_ROW('4'), HEX_ROW('5'), HEX_ROW('6'), HEX_ROW('7'),
+    HEX_ROW('8'), HEX_ROW('9'), HEX_ROW('A'), HEX_ROW('B'),
+    HEX_ROW('C'), HEX_ROW('D'), HEX_ROW('E'), HEX_ROW('F'),
+};
+
+// Copy raw storage data, anything past the end of storage is left untouched
+static void copy_storage(uint8_t *data, uint32_t storage_offset, uint32_t size)
+{
+    if (storage_offset < STORAGE_SIZE) {
+        memcpy(data, (uint8_t *)(STORAGE_ADDRESS_START + storage_offset), MIN(size, STORAGE_SIZE - storage_offset));
+    }
+}
+
+// Hex encode storage data starting at character char_offset of the byte at storage_offset
+static void encode_storage(uint8_t *data, uint32_t storage_offset, uint32_t char_offset, uint32_t size)
+{
+    const uint8_t *src = (const uint8_t *)(STORAGE_ADDRESS_START + storage_offset);
+    uint32_t i = 0;
+
+    if (storage_offset >= STORAGE_SIZE) {
+        return;
+    }
+    size = MIN(size, (STORAGE_SIZE - storage_offset) * 2 - char_offset);
+
+    if (char_offset && size) {
+        // Low nibble of a byte started in the previous run
+        data[i++] = hex_table[*src++][1];
+    }
+    for (; i + 1 < size; i += 2) {
+        data[i] = hex_table[*src][0];
+        data[i + 1] = hex_table[*src][1];
+        src++;
+    }
+    if (i < size) {
+        data[i] = hex_table[*src][0];
+    }
+}
+
 // File callback to be used with vfs_add_file to return file contents
 static uint32_t read_file_data_txt(uint32_t sector_offset, uint8_t *data, uint32_t num_sectors)
 {
-    uint32_t read_address = STORAGE_ADDRESS_START + (VFS_SECTOR_SIZE * sector_offset);
     uint32_t storage_enc_start = storage_cfg_get_encoding_start();
     uint32_t storage_enc_end = storage_cfg_get_encoding_end();
     uint32_t encoded_data_offset = (storage_enc_end - storage_enc_start);
-
-    // Ignore out of bound reads
-    if ( read_address < (STORAGE_ADDRESS_END + encoded_data_offset) ) {
-        for (uint32_t i = 0; i < VFS_SECTOR_SIZE; i++) {
-            if (i + (VFS_SECTOR_SIZE * sector_offset) < storage_enc_start) {
-                // If data is before encoding window, no offset is needed
-                data[i] = *(uint8_t *) (read_address + i);
-            } else if(i + (VFS_SECTOR_SIZE * sector_offset) < (storage_enc_start + encoded_data_offset * 2)) {
-                // Data inside encoding window needs to consider encoding window start and size
-                uint8_t enc_byte = *(uint8_t *) (STORAGE_ADDRESS_START + ((VFS_SECTOR_SIZE * sector_offset) + storage_enc_start + i ) / 2);
-                if (i % 2 == 0) {
-                    // High nibble
-                    enc_byte = 0x0F & (enc_byte >> 4);
-                } else {
-                    // Low nibble
-                    enc_byte = 0x0F & enc_byte;
-                }
-                // Encode one nibble to one ASCII byte
-                data[i] = enc_byte <= 9 ? enc_byte + 0x30 : enc_byte + 0x37;
-            } else {
-                // If data is after encoding window, adjustment is needed
-                data[i] = *(uint8_t *) (read_address + i - encoded_data_offset);
-            }
+    // The encoding window takes two file bytes per storage byte
+    uint32_t window_end = storage_enc_start + encoded_data_offset * 2;
+    uint32_t pos = VFS_SECTOR_SIZE * sector_offset;
+    uint32_t end = pos + VFS_SECTOR_SIZE * num_sectors;
+    uint32_t n;
+
+    // Data is read straight from flash
+    storage_flush();
+
+    // Each sector is made of at most three runs: raw, encoded and raw again
+    while (pos < end) {
+        if (pos < storage_enc_start) {
+            // If data is before encoding window, no offset is needed
+            n = MIN(end, storage_enc_start) - pos;
+            copy_storage(data, pos, n);
+        } else if (pos < window_end) {
+            // Data inside encoding window needs to consider encoding window start and size
+            n = MIN(end, window_end) - pos;
+            encode_storage(data, storage_enc_start + (pos - storage_enc_start) / 2, (pos - storage_enc_start) & 1, n);
+        } else {
+            // If data is after encoding window, adjustment is needed
+            n = end - pos;
+            copy_storage(data, pos - encoded_data_offset, n);
         }
+        data += n;
+        pos += n;
     }
 
-    return VFS_SECTOR_SIZE;
+    return VFS_SECTOR_SIZE * num_sectors;
 }
 
 uint8_t board_detect_incompatible_image(const uint8_t *data, uint32_t size)
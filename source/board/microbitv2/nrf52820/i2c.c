@@ -22,11 +22,14 @@
 #include <string.h>
 
 #include "main_interface.h"
+#include "cmsis_os2.h"
+#include "cmsis_compiler.h"
 
 #include "i2c.h"
 #include "i2c_commands.h"
 
 #include "Driver_I2C.h"
+#include "DAP_config.h"
 
 // Set to 1 to enable debugging
 #define DEBUG_I2C       0
@@ -48,24 +51,43 @@
 extern ARM_DRIVER_I2C            Driver_I2C0;
 static ARM_DRIVER_I2C *I2Cdrv = &Driver_I2C0;
 
+// Number of received commands that can wait for the main task
+#ifndef I2C_RX_QUEUE_LEN
+#define I2C_RX_QUEUE_LEN            (2)
+#endif
+
+// 30ms ticks after which an unread response no longer holds back the queue
+#ifndef I2C_RESPONSE_TIMEOUT_TICKS
+#define I2C_RESPONSE_TIMEOUT_TICKS  (4)
+#endif
+
+typedef struct rxSlot_s {
+    uint8_t     data[I2C_DATA_LENGTH];
+    i2cCallback_t pfCallback;
+    uint8_t     size;
+    uint32_t    timestamp;          // Reception time, TIMESTAMP_GET() cycles
+} rxSlot_t;
+
 static uint16_t g_slave_TX_i = 0;
 static uint8_t __ALIGNED(4) g_slave_TX_buff[I2C_DATA_LENGTH] = { 0 };
-static uint8_t __ALIGNED(4) g_slave_RX_buff[I2C_DATA_LENGTH] = { 0 };
+
+// Commands are received into the slot after the queued ones, so the next
+// command can arrive while the main task executes the current one
+static rxSlot_t __ALIGNED(4) g_rx_slots[I2C_RX_QUEUE_LEN];
+static volatile uint8_t g_rx_head = 0;
+static volatile uint8_t g_rx_count = 0;
+// The master is clock stretched until a slot is free
+static volatile bool g_rx_deferred = false;
+// A response is waiting to be read, each command gets its own
+static volatile bool g_tx_pending = false;
+static uint8_t g_tx_pending_ticks = 0;
+
+static i2c_cmd_latency_t g_latency[I2C_LATENCY_TYPES];
 
 static i2cCallback_t pfWriteCommsCallback = NULL;
 static i2cCallback_t pfReadCommsCallback = NULL;
 static i2cCallback_t pfWriteFlashCallback = NULL;
 static i2cCallback_t pfReadFlashCallback = NULL;
-typedef struct callbackToExecute_s {
-    i2cCallback_t pfCallback;
-    uint8_t*    pData;
-    uint8_t     size;
-} callbackToExecute_t;
-static callbackToExecute_t callbackToExecute = {
-    .pfCallback = NULL,
-    .pData = NULL,
-    .size = 0,
-};
 
 static uint8_t i2c_wake_timeout = 0;
 static bool i2c_allow_sleep = true;
@@ -73,6 +95,28 @@ static bool i2c_allow_sleep = true;
 static void i2c_clearTxBuffer(void);
 
 
+static i2c_cmd_latency_t* i2c_latencyEntry(i2cCallback_t callback, uint8_t cmd_id)
+{
+    if (callback == pfWriteCommsCallback) {
+        return &g_latency[0];
+    }
+    if (cmd_id < (I2C_LATENCY_TYPES - 1)) {
+        return &g_latency[1 + cmd_id];
+    }
+    return NULL;
+}
+
+static void i2c_startReceive(void)
+{
+    if (g_rx_count < I2C_RX_QUEUE_LEN) {
+        g_rx_deferred = false;
+        I2Cdrv->SlaveReceive(&g_rx_slots[(g_rx_head + g_rx_count) % I2C_RX_QUEUE_LEN].data[0], I2C_DATA_LENGTH);
+    } else {
+        g_rx_deferred = true;
+    }
+}
+
+
 static void i2c_scheduleCallback(i2cCallback_t callback, uint8_t* pData, uint8_t size)
 {
     if ((callback == pfReadCommsCallback) || (callback == pfReadFlashCallback)) {
@@ -80,12 +124,20 @@ static void i2c_scheduleCallback(i2cCallback_t callback, uint8_t* pData, uint8_t
         debug_i2c_data((uint8_t *)"[cbTx]\n", 7);
         callback(pData, size);
         i2c_clearTxBuffer();
+        // The response has been read, the next command can run
+        g_tx_pending = false;
+        if (g_rx_count > 0) {
+            main_board_event();
+        }
     } else {
-        // Raise an RTOS event to run the heavier I2C RX callback in main task
-        callbackToExecute.pfCallback = callback;
-        callbackToExecute.pData = pData;
-        callbackToExecute.size = size;
+        // Queue the heavier I2C RX callback, pData is the slot just received
+        rxSlot_t *slot = &g_rx_slots[(g_rx_head + g_rx_count) % I2C_RX_QUEUE_LEN];
+        slot->pfCallback = callback;
+        slot->size = size;
+        slot->timestamp = TIMESTAMP_GET();
+        g_rx_count++;
         i2c_allow_sleep = false;
+        // Raise an RTOS event to run it in main task
         main_board_event();
     }
 }
@@ -93,16 +145,53 @@ static void i2c_scheduleCallback(i2cCallback_t callback, uint8_t* pData, uint8_t
 // Hook function executed in the main task
 void board_custom_event()
 {
-    if (callbackToExecute.pfCallback != NULL) {
-        debug_i2c_data((uint8_t *)"[cbRx]\n", 7);
-        callbackToExecute.pfCallback(callbackToExecute.pData, callbackToExecute.size);
+    rxSlot_t *slot;
+    i2c_cmd_latency_t *latency;
+    uint32_t latency_us;
+
+    // Wait until the previous response has been read so it is not overwritten
+    if ((g_rx_count == 0) || g_tx_pending) {
+        return;
+    }
 
-        // Clear the callback data
-        callbackToExecute.pfCallback = NULL;
-        callbackToExecute.pData = NULL;
-        callbackToExecute.size = 0;
+    slot = &g_rx_slots[g_rx_head];
+    debug_i2c_data((uint8_t *)"[cbRx]\n", 7);
+    // Set before the callback, a master reading early clears it from the TX interrupt
+    g_tx_pending = true;
+    g_tx_pending_ticks = 0;
+    slot->pfCallback(&slot->data[0], slot->size);
+
+    latency = i2c_latencyEntry(slot->pfCallback, slot->data[0]);
+    if (latency != NULL) {
+        latency_us = (TIMESTAMP_GET() - slot->timestamp) / (TIMESTAMP_CLOCK / 1000000U);
+        latency->count++;
+        latency->total_us += latency_us;
+        if (latency_us > latency->max_us) {
+            latency->max_us = latency_us;
+        }
+    }
+
+    __disable_irq();
+    g_rx_head = (g_rx_head + 1) % I2C_RX_QUEUE_LEN;
+    g_rx_count--;
+    if (g_rx_deferred) {
+        // Release the master waiting for a free slot
+        i2c_startReceive();
+    }
+    __enable_irq();
+
+    i2c_allow_sleep = true;
+}
 
-        i2c_allow_sleep = true;
+const i2c_cmd_latency_t* i2c_getCmdLatency(uint8_t slaveAddress, uint8_t cmdId)
+{
+    switch (slaveAddress) {
+        case I2C_SLAVE_NRF_KL_COMMS:
+            return &g_latency[0];
+        case I2C_SLAVE_FLASH:
+            return (cmdId < (I2C_LATENCY_TYPES - 1)) ? &g_latency[1 + cmdId] : NULL;
+        default:
+            return NULL;
     }
 }
 
@@ -124,15 +213,16 @@ static void i2c_signalEvent(uint32_t event) {
 
         if (prev_event & ARM_I2C_EVENT_SLAVE_RECEIVE) {
             int32_t data_count = I2Cdrv->GetDataCount();
-            debug_i2c_printf("[R0%x]\n", g_slave_RX_buff[0]);
-            // debug_i2c_array(g_slave_RX_buff, data_count);
+            uint8_t *rx_buff = &g_rx_slots[(g_rx_head + g_rx_count) % I2C_RX_QUEUE_LEN].data[0];
+            debug_i2c_printf("[R0%x]\n", rx_buff[0]);
+            // debug_i2c_array(rx_buff, data_count);
 
             // Ignore NOP commands and 0 length transmissions
-            if ((data_count != 0) && (g_slave_RX_buff[0] != gNopCmd_c)) {
+            if ((data_count != 0) && (rx_buff[0] != gNopCmd_c)) {
                 if (event & EXTENSION_I2C_EVENT_SLAVE_ADDR_0) {
-                    i2c_scheduleCallback(pfWriteCommsCallback, &g_slave_RX_buff[0], data_count);
+                    i2c_scheduleCallback(pfWriteCommsCallback, rx_buff, data_count);
                 } else if (event & EXTENSION_I2C_EVENT_SLAVE_ADDR_1) {
-                    i2c_scheduleCallback(pfWriteFlashCallback, &g_slave_RX_buff[0], data_count);
+                    i2c_scheduleCallback(pfWriteFlashCallback, rx_buff, data_count);
                 }
             }
         } else if (prev_event & ARM_I2C_EVENT_SLAVE_TRANSMIT) {
@@ -156,7 +246,8 @@ static void i2c_signalEvent(uint32_t event) {
         debug_i2c_data((uint8_t *)"g\n", 2);
     }
     if (event & ARM_I2C_EVENT_SLAVE_RECEIVE) {
-        int32_t ret = I2Cdrv->SlaveReceive(&g_slave_RX_buff[0], I2C_DATA_LENGTH);
+        // With all slots taken the bus is stretched until one is free
+        i2c_startReceive();
         i2c_wake_timeout = 4;   // 4 * 30ms tick = 120ms timeout
         // debug_i2c_printf("rx[%d]\n", ret);
     }
@@ -228,10 +319,17 @@ i2c_status_t i2c_registerReadCallback(i2cCallback_t readCallback, uint8_t slaveA
 void i2c_clearState()
 {
     i2c_clearTxBuffer();
-    memset(&g_slave_RX_buff, 0, sizeof(g_slave_RX_buff));
-    callbackToExecute.pfCallback = NULL;
-    callbackToExecute.pData = NULL;
-    callbackToExecute.size = 0;
+
+    // Drop queued commands, the slot being received into becomes the head
+    __disable_irq();
+    g_rx_head = (g_rx_head + g_rx_count) % I2C_RX_QUEUE_LEN;
+    g_rx_count = 0;
+    g_tx_pending = false;
+    if (g_rx_deferred) {
+        i2c_startReceive();
+    }
+    __enable_irq();
+
     i2c_wake_timeout = 0;
     i2c_allow_sleep = true;
 }
@@ -269,7 +367,7 @@ void i2c_fillBufferHead(uint8_t data)
 bool i2c_canSleep()
 {
     ARM_I2C_STATUS status = I2Cdrv->GetStatus();
-    return i2c_allow_sleep && !status.busy && i2c_wake_timeout == 0;
+    return i2c_allow_sleep && g_rx_count == 0 && !status.busy && i2c_wake_timeout == 0;
 }
 
 void i2c_30ms_tick()
@@ -277,4 +375,12 @@ void i2c_30ms_tick()
     if (i2c_wake_timeout > 0) {
         i2c_wake_timeout--;
     }
+
+    // Don't let a response that is never read stall the queue
+    if (g_tx_pending && (++g_tx_pending_ticks >= I2C_RESPONSE_TIMEOUT_TICKS)) {
+        g_tx_pending = false;
+        if (g_rx_count > 0) {
+            main_board_event();
+        }
+    }
 }
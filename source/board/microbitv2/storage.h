@@ -55,14 +55,41 @@ extern "C" {
 #define STORAGE_CFG_FILEVISIBLE     false
 #define STORAGE_CFG_FILESIZE        (STORAGE_SIZE - STORAGE_SECTOR_SIZE)
 
+/**
+ * storage_write() collects data in a RAM copy of one STORAGE_WRITE_CACHE_SIZE
+ * block and programs only the words that were written, once per block. The
+ * block is programmed when it is complete, when a write goes to a different
+ * block, when it has been idle for STORAGE_WRITE_CACHE_IDLE_TICKS, before
+ * any read, erase or power down, and on storage_flush(). Words that fail to
+ * program stay in the cache for the next flush, unless their block is erased.
+ */
+#ifndef STORAGE_WRITE_CACHE_SIZE
+#define STORAGE_WRITE_CACHE_SIZE    (256)
+#endif
+/* Number of storage_30ms_tick() calls without writes before the block is programmed */
+#ifndef STORAGE_WRITE_CACHE_IDLE_TICKS
+#define STORAGE_WRITE_CACHE_IDLE_TICKS  (2)
+#endif
+
 typedef enum {
     STORAGE_SUCCESS = 0,
     STORAGE_ERROR
 } storage_status_t;
 
+typedef struct {
+    uint32_t writes;            // storage_write() calls
+    uint32_t flushes;           // Blocks programmed
+    uint32_t idle_flushes;      // Blocks programmed by the idle timeout
+    uint32_t bytes;             // Bytes programmed
+} storage_cache_stats_t;
+
 void storage_init(void);
 uint8_t* storage_get_data_pointer(uint32_t adr);
 storage_status_t storage_write(uint32_t adr, uint32_t sz, uint8_t *buf);
+storage_status_t storage_flush(void);
+/* This functions needs to be called at a 30ms interval. */
+void storage_30ms_tick(void);
+const storage_cache_stats_t* storage_get_cache_stats(void);
 storage_status_t storage_erase_sector(uint32_t adr);
 storage_status_t storage_erase_range(uint32_t star_adr, uint32_t end_adr);
 storage_status_t storage_erase_all(void);
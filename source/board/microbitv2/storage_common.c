@@ -25,6 +25,7 @@
 
 #include "virtual_fs.h"
 #include "cmsis_compiler.h"
+#include "util.h"
 
 
 // 'scfg' in hex - key valid
@@ -40,6 +41,22 @@ typedef __PACKED_STRUCT storage_cfg_tag {
 } storage_cfg_t;
 
 
+#define STORAGE_WRITE_CACHE_WORDS   (STORAGE_WRITE_CACHE_SIZE / 4)
+
+typedef struct {
+    uint8_t         data[STORAGE_WRITE_CACHE_SIZE];
+    uint32_t        adr;            // Flash address of the cached block
+    uint32_t        dirty[(STORAGE_WRITE_CACHE_WORDS + 31) / 32];   // One bit per written word
+    uint8_t         idle_ticks;
+} storage_cache_t;
+
+COMPILER_ASSERT((STORAGE_WRITE_CACHE_SIZE % 4) == 0);
+COMPILER_ASSERT((STORAGE_SECTOR_SIZE % STORAGE_WRITE_CACHE_SIZE) == 0);
+
+
+static storage_cache_t __ALIGNED(4) s_cache;
+static storage_cache_stats_t s_cache_stats;
+
 static storage_cfg_t __ALIGNED(4) s_storage_cfg = {
     .key = STORAGE_CFG_KEY,
     .fileName = STORAGE_CFG_FILENAME,
@@ -191,6 +208,9 @@ uint32_t storage_cfg_get_encoding_end()
 
 uint8_t* storage_get_data_pointer(uint32_t adr)
 {
+    // The caller reads flash directly
+    storage_flush();
+
     adr += STORAGE_ADDRESS_START;
     if (adr >= STORAGE_ADDRESS_END) {
         return NULL;
@@ -198,8 +218,105 @@ uint8_t* storage_get_data_pointer(uint32_t adr)
     return (uint8_t *)adr;
 }
 
+static bool cache_word_dirty(uint32_t word)
+{
+    return (s_cache.dirty[word / 32] >> (word % 32)) & 1;
+}
+
+static bool cache_dirty(void)
+{
+    for (uint32_t i = 0; i < ARRAY_SIZE(s_cache.dirty); i++) {
+        if (s_cache.dirty[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool cache_complete(void)
+{
+    for (uint32_t word = 0; word < STORAGE_WRITE_CACHE_WORDS; word++) {
+        if (!cache_word_dirty(word)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void cache_set_dirty(uint32_t start, uint32_t end, bool dirty)
+{
+    for (uint32_t word = start; word < end; word++) {
+        if (dirty) {
+            s_cache.dirty[word / 32] |= 1u << (word % 32);
+        } else {
+            s_cache.dirty[word / 32] &= ~(1u << (word % 32));
+        }
+    }
+}
+
+storage_status_t storage_flush(void)
+{
+    bool programmed = false;
+    uint32_t start;
+    uint32_t end;
+
+    // Program each run of written words, the words in between keep their
+    // flash contents and are not programmed twice
+    for (start = 0; start < STORAGE_WRITE_CACHE_WORDS; start = end) {
+        if (!cache_word_dirty(start)) {
+            end = start + 1;
+            continue;
+        }
+        for (end = start + 1; end < STORAGE_WRITE_CACHE_WORDS && cache_word_dirty(end); end++);
+
+        if (storage_program_flash(s_cache.adr + start * 4, (end - start) * 4, &s_cache.data[start * 4]) != STORAGE_SUCCESS) {
+            // Keep the remaining words so the next flush tries again
+            return STORAGE_ERROR;
+        }
+        cache_set_dirty(start, end, false);
+        s_cache_stats.bytes += (end - start) * 4;
+        programmed = true;
+    }
+    if (programmed) {
+        s_cache_stats.flushes++;
+    }
+    return STORAGE_SUCCESS;
+}
+
+void storage_30ms_tick(void)
+{
+    if (!cache_dirty()) {
+        return;
+    }
+    if (++s_cache.idle_ticks >= STORAGE_WRITE_CACHE_IDLE_TICKS) {
+        s_cache_stats.idle_flushes++;
+        s_cache.idle_ticks = 0;
+        storage_flush();
+    }
+}
+
+// Writes to a block that is about to be erased are dropped instead of programmed
+static void cache_erase(uint32_t start_adr, uint32_t end_adr)
+{
+    if (s_cache.adr >= start_adr && s_cache.adr < end_adr) {
+        memset(s_cache.dirty, 0, sizeof(s_cache.dirty));
+    } else {
+        storage_flush();
+    }
+}
+
+const storage_cache_stats_t* storage_get_cache_stats(void)
+{
+    return &s_cache_stats;
+}
+
 storage_status_t storage_write(uint32_t adr, uint32_t sz, uint8_t *buf)
 {
+    storage_status_t status = STORAGE_SUCCESS;
+    uint32_t block;
+    uint32_t offset;
+    uint32_t n;
+
     adr += STORAGE_ADDRESS_START;
     if (
         adr < STORAGE_ADDRESS_START ||
@@ -207,7 +324,39 @@ storage_status_t storage_write(uint32_t adr, uint32_t sz, uint8_t *buf)
     ) {
         return STORAGE_ERROR;
     }
-    return storage_program_flash(adr, sz, buf);
+
+    s_cache_stats.writes++;
+    while (sz > 0 && status == STORAGE_SUCCESS) {
+        block = ROUND_DOWN(adr, STORAGE_WRITE_CACHE_SIZE);
+        offset = adr - block;
+        n = MIN(sz, STORAGE_WRITE_CACHE_SIZE - offset);
+
+        if (cache_dirty() && s_cache.adr != block) {
+            status = storage_flush();
+            if (status != STORAGE_SUCCESS) {
+                break;
+            }
+        }
+
+        if (!cache_dirty()) {
+            // Start from the flash contents so merging partial words is harmless
+            s_cache.adr = block;
+            memcpy(s_cache.data, (void *)block, STORAGE_WRITE_CACHE_SIZE);
+        }
+        memcpy(&s_cache.data[offset], buf, n);
+        cache_set_dirty(offset / 4, (offset + n + 3) / 4, true);
+        s_cache.idle_ticks = 0;
+
+        if (cache_complete()) {
+            // Block complete
+            status = storage_flush();
+        }
+
+        adr += n;
+        buf += n;
+        sz -= n;
+    }
+    return status;
 }
 
 storage_status_t storage_erase_sector(uint32_t adr)
@@ -219,6 +368,7 @@ storage_status_t storage_erase_sector(uint32_t adr)
     ) {
         return STORAGE_ERROR;
     }
+    cache_erase(adr, adr + STORAGE_SECTOR_SIZE);
     return storage_erase_flash_page(adr);
 }
 
@@ -235,6 +385,7 @@ storage_status_t storage_erase_range(uint32_t star_adr, uint32_t end_adr)
         star_adr >= STORAGE_ADDRESS_START &&
         end_adr < STORAGE_ADDRESS_END
     ) {
+        cache_erase(star_adr, end_adr + STORAGE_SECTOR_SIZE);
         for (uint32_t addr = star_adr;
              addr <= end_adr && status == STORAGE_SUCCESS;
              addr += STORAGE_SECTOR_SIZE
@@ -128,6 +128,7 @@ void main_blink_msc_led(main_led_state_t state)
 
 void USBD_SignalHandler()
 {
+    usbd_signal();
     osThreadFlagsSet(main_task_id, FLAGS_MAIN_PROC_USB);
 }
 
@@ -174,7 +175,7 @@ void main_task(void * arg)
                         osWaitForever);
 
         if (flags & FLAGS_MAIN_PROC_USB) {
-            USBD_Handler();
+            usbd_handler();
         }
 
         if (flags & FLAGS_MAIN_90MS) {
@@ -235,6 +235,11 @@ static uint32_t DAP_Connect(const uint8_t *request, uint8_t *response) {
     port = *request;
   }
 
+#if (DAP_JTAG != 0)
+  // Nothing is known about the TAP of a new connection
+  JTAG_IR_Invalidate();
+#endif
+
   switch (port) {
 #if (DAP_SWD != 0)
     case DAP_PORT_SWD:
@@ -265,6 +270,9 @@ static uint32_t DAP_Disconnect(uint8_t *response) {
 
   DAP_Data.debug_port = DAP_PORT_DISABLED;
   PORT_OFF();
+#if (DAP_JTAG != 0)
+  JTAG_IR_Invalidate();
+#endif
 
   *response = DAP_OK;
   return (1U);
@@ -276,6 +284,10 @@ static uint32_t DAP_Disconnect(uint8_t *response) {
 //   return:   number of bytes in response
 static uint32_t DAP_ResetTarget(uint8_t *response) {
 
+#if (DAP_JTAG != 0)
+  // The reset may reach the TAP as well
+  JTAG_IR_Invalidate();
+#endif
   *(response+1) = RESET_TARGET();
   *(response+0) = DAP_OK;
   return (2U);
@@ -301,6 +313,11 @@ static uint32_t DAP_SWJ_Pins(const uint8_t *request, uint8_t *response) {
            (uint32_t)(*(request+4) << 16) |
            (uint32_t)(*(request+5) << 24);
 
+#if (DAP_JTAG != 0)
+  // Pins driven directly may clock or reset the TAP
+  JTAG_IR_Invalidate();
+#endif
+
   if ((select & (1U << DAP_SWJ_SWCLK_TCK)) != 0U) {
     if ((value & (1U << DAP_SWJ_SWCLK_TCK)) != 0U) {
       PIN_SWCLK_TCK_SET();
@@ -458,6 +475,9 @@ static uint32_t DAP_SWJ_Sequence(const uint8_t *request, uint8_t *response) {
 
 #if ((DAP_SWD != 0) || (DAP_JTAG != 0))
   SWJ_Sequence(count, request);
+#if (DAP_JTAG != 0)
+  JTAG_IR_Invalidate();
+#endif
   *response = DAP_OK;
 #else
   *response = DAP_ERROR;
@@ -617,6 +637,7 @@ static uint32_t DAP_JTAG_Configure(const uint8_t *request, uint8_t *response) {
     bits -= DAP_Data.jtag_dev.ir_length[n];
     DAP_Data.jtag_dev.ir_after[n] = (uint16_t)bits;
   }
+  JTAG_IR_Invalidate();
 
   *response = DAP_OK;
 #else
@@ -1223,6 +1244,9 @@ static uint32_t DAP_JTAG_Transfer(const uint8_t *request, uint8_t *response) {
   }
 
 end:
+  // Leave the TAP in Run-Test/Idle between commands
+  JTAG_Idle();
+
   *(response_head+0) = (uint8_t)response_count;
   *(response_head+1) = (uint8_t)response_value;
 
@@ -1501,6 +1525,9 @@ static uint32_t DAP_JTAG_TransferBlock(const uint8_t *request, uint8_t *response
   }
 
 end:
+  // Leave the TAP in Run-Test/Idle between commands
+  JTAG_Idle();
+
   *(response_head+0) = (uint8_t)(response_count >> 0);
   *(response_head+1) = (uint8_t)(response_count >> 8);
   *(response_head+2) = (uint8_t) response_value;
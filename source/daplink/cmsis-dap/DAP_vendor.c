@@ -41,6 +41,7 @@
 #include "util.h"
 #include <string.h>
 #include "daplink_vendor_commands.h"
+#include "swo_itm.h"
 
 #ifdef DRAG_N_DROP_SUPPORT
 #include "file_stream.h"
@@ -129,7 +130,17 @@ uint32_t DAP_ProcessVendorCommand(const uint8_t *request, uint8_t *response) {
         num += ((write_len + 1) << 16) | 1;
         break;
     }
-    case ID_DAP_Vendor5:  break;
+    case ID_DAP_GetBootProfile: {
+        // read the startup profile
+        //              BYTE 0      Number of phases recorded
+        //              BYTE 1..    Microseconds from start to the end of each phase, little endian words
+        uint32_t times[kBootPhaseCount];
+        uint8_t count = config_ram_get_boot_times(times, kBootPhaseCount);
+        *response++ = count;
+        memcpy(response, times, count * sizeof(uint32_t));
+        num += 1 + count * sizeof(uint32_t);
+        break;
+    }
     case ID_DAP_Vendor6:  break;
     case ID_DAP_Vendor7:  break;
     case ID_DAP_SetUSBTestMode: {
@@ -224,7 +235,16 @@ uint32_t DAP_ProcessVendorCommand(const uint8_t *request, uint8_t *response) {
         num += (1U << 16) | 1U; // increment request and response count each by 1
         break;
     }
-    case ID_DAP_Vendor14: break;
+#if (((SWO_UART != 0) || (SWO_MANCHESTER != 0)) && (SWO_ITM_FILTER != 0))
+    case ID_DAP_SWO_ITMFilter: {
+        // configure ITM packet filtering of captured SWO data
+        //              BYTE 0      Packet types to keep (SWO_ITM_KEEP_*)
+        //              BYTE 1..4   Stimulus ports to keep
+        //              BYTE 5..8   Stimulus ports routed to swo_itm_route()
+        num += SWO_ITMFilter(request, response);
+        break;
+    }
+#endif
     case ID_DAP_Vendor15: break;
     case ID_DAP_Vendor16: break;
     case ID_DAP_Vendor17: break;
@@ -64,12 +64,49 @@
   PIN_TCK_SET();                        \
   PIN_DELAY()
 
+#define JTAG_BYTE_TDI(tdi)              \
+  JTAG_CYCLE_TDI((tdi) >> 0);           \
+  JTAG_CYCLE_TDI((tdi) >> 1);           \
+  JTAG_CYCLE_TDI((tdi) >> 2);           \
+  JTAG_CYCLE_TDI((tdi) >> 3);           \
+  JTAG_CYCLE_TDI((tdi) >> 4);           \
+  JTAG_CYCLE_TDI((tdi) >> 5);           \
+  JTAG_CYCLE_TDI((tdi) >> 6);           \
+  JTAG_CYCLE_TDI((tdi) >> 7)
+
+#define JTAG_BYTE_TDIO(tdi,tdo,bit)     \
+  JTAG_CYCLE_TDIO((tdi) >> 0, bit);     \
+  tdo  = bit << 0;                      \
+  JTAG_CYCLE_TDIO((tdi) >> 1, bit);     \
+  tdo |= bit << 1;                      \
+  JTAG_CYCLE_TDIO((tdi) >> 2, bit);     \
+  tdo |= bit << 2;                      \
+  JTAG_CYCLE_TDIO((tdi) >> 3, bit);     \
+  tdo |= bit << 3;                      \
+  JTAG_CYCLE_TDIO((tdi) >> 4, bit);     \
+  tdo |= bit << 4;                      \
+  JTAG_CYCLE_TDIO((tdi) >> 5, bit);     \
+  tdo |= bit << 5;                      \
+  JTAG_CYCLE_TDIO((tdi) >> 6, bit);     \
+  tdo |= bit << 6;                      \
+  JTAG_CYCLE_TDIO((tdi) >> 7, bit);     \
+  tdo |= bit << 7
+
 #define PIN_DELAY() PIN_DELAY_SLOW(DAP_Data.clock_delay)
 
 
 #if (DAP_JTAG != 0)
 
 
+// IR of the selected TAP as last scanned, all other TAPs are in BYPASS
+static uint32_t jtag_ir_value;
+static uint8_t  jtag_ir_index;
+static uint8_t  jtag_ir_valid;
+
+// Last DR scan ended in Update-DR instead of Run-Test/Idle
+static uint8_t  jtag_update_dr;
+
+
 // Generate JTAG Sequence
 //   info:   sequence information
 //   tdi:    pointer to TDI generated data
@@ -86,24 +123,45 @@ void JTAG_Sequence (uint32_t info, const uint8_t *tdi, uint8_t *tdo) {
     n = 64U;
   }
 
+  // The sequence may move the TAP anywhere, including Test-Logic-Reset
+  jtag_ir_valid = 0U;
+
   if (info & JTAG_SEQUENCE_TMS) {
     PIN_TMS_SET();
   } else {
     PIN_TMS_CLR();
   }
 
-  while (n) {
-    i_val = *tdi++;
-    o_val = 0U;
-    for (k = 8U; k && n; k--, n--) {
-      JTAG_CYCLE_TDIO(i_val, bit);
-      i_val >>= 1;
-      o_val >>= 1;
-      o_val  |= bit << 7;
+  // Whole bytes, 8 TCK cycles unrolled, TDO only sampled when requested
+  if (info & JTAG_SEQUENCE_TDO) {
+    for (; n >= 8U; n -= 8U) {
+      i_val = *tdi++;
+      JTAG_BYTE_TDIO(i_val, o_val, bit);
+      *tdo++ = (uint8_t)o_val;
+    }
+  } else {
+    for (; n >= 8U; n -= 8U) {
+      i_val = *tdi++;
+      JTAG_BYTE_TDI(i_val);
     }
-    o_val >>= k;
+  }
+
+  // Remaining bits
+  if (n) {
+    i_val = *tdi;
+    o_val = 0U;
     if (info & JTAG_SEQUENCE_TDO) {
-      *tdo++ = (uint8_t)o_val;
+      for (k = 0U; k < n; k++) {
+        JTAG_CYCLE_TDIO(i_val, bit);
+        i_val >>= 1;
+        o_val  |= bit << k;
+      }
+      *tdo = (uint8_t)o_val;
+    } else {
+      for (k = 0U; k < n; k++) {
+        JTAG_CYCLE_TDI(i_val);
+        i_val >>= 1;
+      }
     }
   }
 }
@@ -149,6 +207,7 @@ static void JTAG_IR_##speed (uint32_t ir) {
   PIN_TMS_CLR();                                                                \
   JTAG_CYCLE_TCK();                         /* Idle */                          \
   PIN_TDI_OUT(1U);                                                              \
+  jtag_update_dr = 0U;                                                          \
 }
 
 
@@ -182,6 +241,9 @@ static uint8_t JTAG_Transfer##speed (uint32_t request, uint32_t *data) {
                                                                                 \
   if (ack != DAP_TRANSFER_OK) {                                                 \
     /* Exit on error */                                                         \
+    if (ack != DAP_TRANSFER_WAIT) {                                             \
+      jtag_ir_valid = 0U;                   /* TAP state unknown */             \
+    }                                                                           \
     PIN_TMS_SET();                                                              \
     JTAG_CYCLE_TCK();                       /* Exit1-DR */                      \
     goto exit;                                                                  \
@@ -232,8 +294,6 @@ static uint8_t JTAG_Transfer##speed (uint32_t request, uint32_t *data) {
                                                                                 \
 exit:                                                                           \
   JTAG_CYCLE_TCK();                         /* Update-DR */                     \
-  PIN_TMS_CLR();                                                                \
-  JTAG_CYCLE_TCK();                         /* Idle */                          \
   PIN_TDI_OUT(1U);                                                              \
                                                                                 \
   /* Capture Timestamp */                                                       \
@@ -241,10 +301,17 @@ exit:
     DAP_Data.timestamp = TIMESTAMP_GET();                                       \
   }                                                                             \
                                                                                 \
-  /* Idle cycles */                                                             \
+  /* Idle cycles, without any the next scan starts from Update-DR */            \
   n = DAP_Data.transfer.idle_cycles;                                            \
-  while (n--) {                                                                 \
+  if (n == 0U) {                                                                \
+    jtag_update_dr = 1U;                                                        \
+  } else {                                                                      \
+    PIN_TMS_CLR();                                                              \
     JTAG_CYCLE_TCK();                       /* Idle */                          \
+    while (n--) {                                                               \
+      JTAG_CYCLE_TCK();                     /* Idle */                          \
+    }                                                                           \
+    jtag_update_dr = 0U;                                                        \
   }                                                                             \
                                                                                 \
   return ((uint8_t)ack);                                                        \
@@ -292,6 +359,7 @@ uint32_t JTAG_ReadIDCode (void) {
   JTAG_CYCLE_TCK();                         /* Update-DR */
   PIN_TMS_CLR();
   JTAG_CYCLE_TCK();                         /* Idle */
+  jtag_update_dr = 0U;
 
   return (val);
 }
@@ -339,18 +407,43 @@ void JTAG_WriteAbort (uint32_t data) {
   PIN_TMS_CLR();
   JTAG_CYCLE_TCK();                         /* Idle */
   PIN_TDI_OUT(1U);
+  jtag_update_dr = 0U;
 }
 
 
-// JTAG Set IR
+// JTAG Set IR, skipped when the selected TAP already holds the value
 //   ir:     IR value
 //   return: none
 void JTAG_IR (uint32_t ir) {
+  if (jtag_ir_valid && (jtag_ir_index == DAP_Data.jtag_dev.index) && (jtag_ir_value == ir)) {
+    return;
+  }
   if (DAP_Data.fast_clock) {
     JTAG_IR_Fast(ir);
   } else {
     JTAG_IR_Slow(ir);
   }
+  jtag_ir_value = ir;
+  jtag_ir_index = DAP_Data.jtag_dev.index;
+  jtag_ir_valid = 1U;
+}
+
+
+// JTAG Forget IR, called when the TAP state may have changed outside of JTAG_DP
+//   return: none
+void JTAG_IR_Invalidate (void) {
+  jtag_ir_valid = 0U;
+}
+
+
+// JTAG Return to Run-Test/Idle after chained DR scans
+//   return: none
+void JTAG_Idle (void) {
+  if (jtag_update_dr) {
+    PIN_TMS_CLR();
+    JTAG_CYCLE_TCK();                       /* Idle */
+    jtag_update_dr = 0U;
+  }
 }
 
 
@@ -27,9 +27,14 @@
 
 #include "DAP_config.h"
 #include "DAP.h"
+#include "swo_decode.h"
+#include "swo_itm.h"
 #if (SWO_UART != 0)
 #include "Driver_USART.h"
 #endif
+#if (SWO_AUTOBAUD != 0)
+#include "cmsis_os2.h"
+#endif
 #if (SWO_STREAM != 0)
 #include "cmsis_os2.h"
 #define   osObjectsExternal
@@ -85,7 +90,16 @@ static volatile struct {
 } TraceTimestamp;
 #endif
 
+#if (SWO_ITM_FILTER != 0)
+// ITM Packet Filter
+static swo_itm_filter_t ItmFilter = {
+  .keep_types = SWO_ITM_KEEP_ALL,
+  .keep_ports = 0xFFFFFFFFU,
+};
+#endif
+
 // Trace Helper functions
+static uint32_t FilterTrace    (uint32_t index, uint32_t num);
 static void     ClearTrace     (void);
 static void     ResumeTrace    (void);
 static uint32_t GetTraceCount  (void);
@@ -115,7 +129,7 @@ static void USART_Callback (uint32_t event) {
 #endif
     index_o  = TraceIndexO;
     index_i  = TraceIndexI;
-    index_i += TraceBlockSize;
+    index_i += FilterTrace(index_i, TraceBlockSize);
     TraceIndexI = index_i;
 #if (TIMESTAMP_CLOCK != 0U)
     TraceTimestamp.index = index_i;
@@ -190,7 +204,7 @@ __WEAK uint32_t SWO_Baudrate_UART (uint32_t baudrate) {
   if (TraceStatus & DAP_SWO_CAPTURE_ACTIVE) {
     pUSART->Control(ARM_USART_CONTROL_RX, 0U);
     if (pUSART->GetStatus().rx_busy) {
-      TraceIndexI += pUSART->GetRxCount();
+      TraceIndexI += FilterTrace(TraceIndexI, pUSART->GetRxCount());
       pUSART->Control(ARM_USART_ABORT_RECEIVE, 0U);
     }
   }
@@ -243,7 +257,7 @@ __WEAK uint32_t SWO_Control_UART (uint32_t active) {
   } else {
     pUSART->Control(ARM_USART_CONTROL_RX, 0U);
     if (pUSART->GetStatus().rx_busy) {
-      TraceIndexI += pUSART->GetRxCount();
+      TraceIndexI += FilterTrace(TraceIndexI, pUSART->GetRxCount());
       pUSART->Control(ARM_USART_ABORT_RECEIVE, 0U);
     }
   }
@@ -276,41 +290,246 @@ __WEAK uint32_t SWO_GetCount_UART (void) {
 
 #if (SWO_MANCHESTER != 0)
 
+static swo_manchester_t ManchesterDecoder;          /* Manchester Decoder */
+static          uint32_t ManchesterClock     = 0U;  /* Capture Timer Clock */
+static          uint32_t ManchesterHalfTicks = 0U;  /* Nominal Half-bit Ticks */
+static volatile uint8_t  ManchesterCapture   = 0U;  /* Capture Active Flag */
+
+// Store decoded Manchester byte in Trace Buffer
+//   data: decoded byte
+static void Manchester_Put (uint8_t data) {
+  uint32_t index_i;
+  uint32_t index_o;
+
+  index_i = TraceIndexI;
+  index_o = TraceIndexO;
+  if ((index_i - index_o) >= SWO_BUFFER_SIZE) {
+    ManchesterCapture = 0U;
+    TraceStatus = DAP_SWO_CAPTURE_ACTIVE | DAP_SWO_CAPTURE_PAUSED;
+    return;
+  }
+  TraceBuf[index_i & (SWO_BUFFER_SIZE - 1U)] = data;
+  if (FilterTrace(index_i, 1U) == 0U) {
+    return;
+  }
+  index_i++;
+  TraceIndexI = index_i;
+#if (TIMESTAMP_CLOCK != 0U)
+  TraceTimestamp.tick  = TIMESTAMP_GET();
+  TraceTimestamp.index = index_i;
+#endif
+  TraceUpdate = 1U;
+#if (SWO_STREAM != 0)
+  if (TraceTransport == 2U) {
+    if ((index_i - index_o) >= (USB_BLOCK_SIZE - (index_o & (USB_BLOCK_SIZE - 1U)))) {
+      osThreadFlagsSet(SWO_ThreadId, 1U);
+    }
+  }
+#endif
+}
+
 // Enable or disable SWO Mode (Manchester)
 //   enable: enable flag
 //   return: 1 - Success, 0 - Error
 __WEAK uint32_t SWO_Mode_Manchester (uint32_t enable) {
-  return (0U);
+
+  ManchesterCapture   = 0U;
+  ManchesterHalfTicks = 0U;
+
+  if (enable != 0U) {
+    ManchesterClock = swo_capture_init();
+    if (ManchesterClock == 0U) {
+      return (0U);
+    }
+  } else {
+    swo_capture_control(0U);
+    swo_capture_uninit();
+  }
+  return (1U);
 }
 
 // Configure SWO Baudrate (Manchester)
 //   baudrate: requested baudrate
 //   return:   actual baudrate or 0 when not configured
 __WEAK uint32_t SWO_Baudrate_Manchester (uint32_t baudrate) {
-  return (0U);
+  uint32_t max_baudrate;
+
+  max_baudrate = ManchesterClock / (2U * SWO_MANCHESTER_MIN_TICKS);
+  if (baudrate > max_baudrate) {
+    baudrate = max_baudrate;
+  }
+  if (baudrate == 0U) {
+    ManchesterHalfTicks = 0U;
+    return (0U);
+  }
+
+  ManchesterHalfTicks = ManchesterClock / (2U * baudrate);
+  if (ManchesterCapture != 0U) {
+    swo_manchester_init(&ManchesterDecoder, ManchesterHalfTicks);
+  }
+
+  return (ManchesterClock / (2U * ManchesterHalfTicks));
 }
 
 // Control SWO Capture (Manchester)
 //   active: active flag
 //   return: 1 - Success, 0 - Error
 __WEAK uint32_t SWO_Control_Manchester (uint32_t active) {
-  return (0U);
+
+  if (active) {
+    if (ManchesterHalfTicks == 0U) {
+      return (0U);
+    }
+    swo_manchester_init(&ManchesterDecoder, ManchesterHalfTicks);
+    ManchesterCapture = 1U;
+    swo_capture_control(1U);
+  } else {
+    swo_capture_control(0U);
+    ManchesterCapture = 0U;
+  }
+  return (1U);
 }
 
 // Start SWO Capture (Manchester)
 //   buf: pointer to buffer for capturing
 //   num: number of bytes to capture
 __WEAK void SWO_Capture_Manchester (uint8_t *buf, uint32_t num) {
+  (void)buf;
+  (void)num;
+
+  // Decoded bytes are stored directly at TraceIndexI. The decoder lost
+  // track of the packet while paused so resynchronize on the idle line.
+  swo_manchester_init(&ManchesterDecoder, ManchesterHalfTicks);
+  ManchesterCapture = 1U;
 }
 
 // Get SWO Pending Trace Count (Manchester)
 //   return: number of pending trace data bytes
 __WEAK uint32_t SWO_GetCount_Manchester (void) {
+  return (0U);
 }
 
 #endif  /* (SWO_MANCHESTER != 0) */
 
 
+#if ((SWO_MANCHESTER != 0) || (SWO_AUTOBAUD != 0))
+
+#if (SWO_AUTOBAUD != 0)
+static          swo_autobaud_t AutoBaud;            /* Baudrate Detector */
+static volatile uint8_t        AutoBaudActive = 0U; /* Detection Active Flag */
+#endif
+
+// Initialize SWO pin timer capture (HIC hook)
+//   return: capture timer clock in Hz or 0 when not supported
+__WEAK uint32_t swo_capture_init (void) {
+  return (0U);
+}
+
+// Uninitialize SWO pin timer capture (HIC hook)
+__WEAK void swo_capture_uninit (void) {
+}
+
+// Enable or disable SWO pin edge interrupts (HIC hook)
+//   enable: enable flag
+__WEAK void swo_capture_control (uint32_t enable) {
+  (void)enable;
+}
+
+// SWO pin edge captured, called by the HIC from the capture interrupt
+//   level: line level of the period that just ended
+//   ticks: length of the period in capture timer ticks
+void swo_capture_edge (uint32_t level, uint32_t ticks) {
+#if (SWO_MANCHESTER != 0)
+  uint32_t errors;
+  uint8_t  data;
+#endif
+
+#if (SWO_AUTOBAUD != 0)
+  if (AutoBaudActive != 0U) {
+    swo_autobaud_put(&AutoBaud, ticks);
+    return;
+  }
+#endif
+#if (SWO_MANCHESTER != 0)
+  if (ManchesterCapture != 0U) {
+    errors = ManchesterDecoder.errors;
+    if (swo_manchester_decode(&ManchesterDecoder, level, ticks, &data) != 0U) {
+      Manchester_Put(data);
+    }
+    if (ManchesterDecoder.errors != errors) {
+      SetTraceError(DAP_SWO_STREAM_ERROR);
+    }
+  }
+#else
+  (void)level;
+#endif
+}
+
+#endif  /* ((SWO_MANCHESTER != 0) || (SWO_AUTOBAUD != 0)) */
+
+
+#if (SWO_AUTOBAUD != 0)
+
+// Detect SWO Baudrate from the shortest pulse on the SWO pin
+//   pulses: number of shortest pulses per bit (1 - UART, 2 - Manchester)
+//   return: detected baudrate or 0 when not detected
+static uint32_t SWO_AutoBaud (uint32_t pulses) {
+  uint32_t clock;
+  uint32_t baudrate;
+  uint32_t n;
+
+  if (TraceStatus & DAP_SWO_CAPTURE_ACTIVE) {
+    return (0U);
+  }
+
+  clock = swo_capture_init();
+  if (clock == 0U) {
+    return (0U);
+  }
+
+  swo_autobaud_init(&AutoBaud);
+  AutoBaudActive = 1U;
+  swo_capture_control(1U);
+
+  baudrate = 0U;
+  for (n = 0U; n < SWO_AUTOBAUD_TIMEOUT; n++) {
+    osDelay(1U);
+    baudrate = swo_autobaud_get(&AutoBaud, clock, pulses);
+    if (baudrate != 0U) {
+      break;
+    }
+  }
+
+  swo_capture_control(0U);
+  AutoBaudActive = 0U;
+  if (TraceMode != DAP_SWO_MANCHESTER) {
+    swo_capture_uninit();
+  }
+
+  return (baudrate);
+}
+
+#endif  /* (SWO_AUTOBAUD != 0) */
+
+
+// Filter received Trace Data in place
+//   index: trace index of the first received byte
+//   num:   number of received bytes
+//   return number of bytes kept
+static uint32_t FilterTrace (uint32_t index, uint32_t num) {
+#if (SWO_ITM_FILTER != 0)
+  uint8_t *buf;
+
+  if (ItmFilter.enabled) {
+    buf = &TraceBuf[index & (SWO_BUFFER_SIZE - 1U)];
+    num = swo_itm_filter(&ItmFilter, buf, buf, num);
+  }
+#else
+  (void)index;
+#endif
+  return (num);
+}
+
 // Clear Trace Errors and Data
 static void ClearTrace (void) {
 
@@ -329,6 +548,10 @@ static void ClearTrace (void) {
   TraceIndexI   = 0U;
   TraceIndexO   = 0U;
 
+#if (SWO_ITM_FILTER != 0)
+  swo_itm_filter_reset(&ItmFilter);
+#endif
+
 #if (TIMESTAMP_CLOCK != 0U)
   TraceTimestamp.index = 0U;
   TraceTimestamp.tick  = 0U;
@@ -374,6 +597,12 @@ static uint32_t GetTraceCount (void) {
     do {
       TraceUpdate = 0U;
       count = TraceIndexI - TraceIndexO;
+#if (SWO_ITM_FILTER != 0)
+      // Bytes still being received have not been filtered yet
+      if (ItmFilter.enabled) {
+        continue;
+      }
+#endif
       switch (TraceMode) {
 #if (SWO_UART != 0)
         case DAP_SWO_UART:
@@ -533,11 +762,24 @@ uint32_t SWO_Baudrate (const uint8_t *request, uint8_t *response) {
   switch (TraceMode) {
 #if (SWO_UART != 0)
     case DAP_SWO_UART:
+#if (SWO_AUTOBAUD != 0)
+      if (baudrate == 0U) {
+        baudrate = SWO_AutoBaud(1U);
+        if (baudrate == 0U) {
+          break;
+        }
+      }
+#endif
       baudrate = SWO_Baudrate_UART(baudrate);
       break;
 #endif
 #if (SWO_MANCHESTER != 0)
     case DAP_SWO_MANCHESTER:
+#if (SWO_AUTOBAUD != 0)
+      if (baudrate == 0U) {
+        baudrate = SWO_AutoBaud(2U);
+      }
+#endif
       baudrate = SWO_Baudrate_Manchester(baudrate);
       break;
 #endif
@@ -732,6 +974,49 @@ uint32_t SWO_Data (const uint8_t *request, uint8_t *response) {
 }
 
 
+#if (SWO_ITM_FILTER != 0)
+
+// Routed ITM stimulus port data (weak hook, data is dropped by default)
+//   port: stimulus port number
+//   data: payload byte
+__WEAK void swo_itm_route (uint8_t port, uint8_t data) {
+  (void)port;
+  (void)data;
+}
+
+// Process SWO ITM Filter vendor command and prepare response
+//   request:  pointer to request data
+//   response: pointer to response data
+//   return:   number of bytes in response (lower 16 bits)
+//             number of bytes in request (upper 16 bits)
+uint32_t SWO_ITMFilter (const uint8_t *request, uint8_t *response) {
+  uint8_t  types;
+  uint32_t ports;
+  uint32_t route;
+
+  types = *request;
+  ports = (uint32_t)(*(request+1) <<  0) |
+          (uint32_t)(*(request+2) <<  8) |
+          (uint32_t)(*(request+3) << 16) |
+          (uint32_t)(*(request+4) << 24);
+  route = (uint32_t)(*(request+5) <<  0) |
+          (uint32_t)(*(request+6) <<  8) |
+          (uint32_t)(*(request+7) << 16) |
+          (uint32_t)(*(request+8) << 24);
+
+  if ((TraceStatus & DAP_SWO_CAPTURE_ACTIVE) == 0U) {
+    swo_itm_filter_init(&ItmFilter, types, ports, route);
+    *response = DAP_OK;
+  } else {
+    *response = DAP_ERROR;
+  }
+
+  return ((9U << 16) | 1U);
+}
+
+#endif  /* (SWO_ITM_FILTER != 0) */
+
+
 #if (SWO_STREAM != 0)
 
 // SWO Data Transfer complete callback
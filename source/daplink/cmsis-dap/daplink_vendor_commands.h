@@ -29,11 +29,13 @@
 #define ID_DAP_UART_SetConfiguration    ID_DAP_Vendor2
 #define ID_DAP_UART_Read                ID_DAP_Vendor3
 #define ID_DAP_UART_Write               ID_DAP_Vendor4
+#define ID_DAP_GetBootProfile           ID_DAP_Vendor5
 #define ID_DAP_SetUSBTestMode           ID_DAP_Vendor8
 #define ID_DAP_ResetTargetIfNoAutoReset ID_DAP_Vendor9
 #define ID_DAP_MSD_Open                 ID_DAP_Vendor10
 #define ID_DAP_MSD_Close                ID_DAP_Vendor11
 #define ID_DAP_MSD_Write                ID_DAP_Vendor12
 #define ID_DAP_SelectEraseMode          ID_DAP_Vendor13
+#define ID_DAP_SWO_ITMFilter            ID_DAP_Vendor14
 //@}
 
@@ -0,0 +1,195 @@
+/**
+ * @file    swo_decode.c
+ * @brief   SWO Manchester decoder and baudrate detection
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2021, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "swo_decode.h"
+
+// This file has no HIC dependencies so it can be built and exercised on the host.
+
+static void manchester_error(swo_manchester_t *dec)
+{
+    dec->errors++;
+    dec->state = kSwoManchesterSync;
+}
+
+// Process one half-bit. Return 1 when a data byte has been completed.
+static uint32_t manchester_half(swo_manchester_t *dec, uint32_t level, uint8_t *data)
+{
+    if (!dec->half) {
+        dec->first = level;
+        dec->half = 1;
+        return 0;
+    }
+
+    dec->half = 0;
+    // Every bit must have a transition in the middle
+    if (dec->first == level) {
+        manchester_error(dec);
+        return 0;
+    }
+
+    if (dec->start) {
+        dec->start = 0;
+        return 0;
+    }
+
+    dec->shift = (dec->shift >> 1) | (dec->first << 7);
+    dec->bits++;
+    if (dec->bits == 8) {
+        *data = dec->shift;
+        dec->bits = 0;
+        return 1;
+    }
+    return 0;
+}
+
+void swo_manchester_init(swo_manchester_t *dec, uint32_t nominal_ticks)
+{
+    dec->nominal_ticks = nominal_ticks;
+    dec->half_ticks = nominal_ticks;
+    dec->errors = 0;
+    dec->state = kSwoManchesterSync;
+    dec->start = 0;
+    dec->half = 0;
+    dec->first = 0;
+    dec->shift = 0;
+    dec->bits = 0;
+}
+
+uint32_t swo_manchester_decode(swo_manchester_t *dec, uint32_t level, uint32_t ticks, uint8_t *data)
+{
+    uint32_t halves;
+    uint32_t result = 0;
+
+    level = level ? 1 : 0;
+
+    switch (dec->state) {
+        case kSwoManchesterSync:
+            // Resynchronize on a low period longer than any valid in-packet period
+            if ((level == 0) && ((dec->nominal_ticks == 0) || (ticks * 2 > dec->nominal_ticks * 5))) {
+                dec->state = kSwoManchesterIdle;
+            }
+            return 0;
+
+        case kSwoManchesterIdle:
+            if (level == 0) {
+                return 0;
+            }
+            if (ticks < SWO_MANCHESTER_MIN_TICKS) {
+                // Glitch on an idle line
+                dec->state = kSwoManchesterSync;
+                return 0;
+            }
+            // The high half of the start bit is never merged with a neighbouring
+            // half so it is the timing reference for the rest of the packet.
+            dec->half_ticks = ticks;
+            dec->start = 1;
+            dec->half = 1;
+            dec->first = 1;
+            dec->shift = 0;
+            dec->bits = 0;
+            dec->state = kSwoManchesterData;
+            return 0;
+
+        case kSwoManchesterData:
+        default:
+            break;
+    }
+
+    if (ticks * 2 < dec->half_ticks) {
+        manchester_error(dec);
+        return 0;
+    } else if (ticks * 2 < dec->half_ticks * 3) {
+        halves = 1;
+    } else if (ticks * 2 < dec->half_ticks * 5) {
+        halves = 2;
+    } else if (level == 0) {
+        // End of packet. The final low half of a 1 bit merges with the idle line.
+        if (dec->half) {
+            result = manchester_half(dec, 0, data);
+            if (dec->state != kSwoManchesterData) {
+                return 0;
+            }
+        }
+        if (dec->bits != 0) {
+            dec->errors++;
+        }
+        dec->state = kSwoManchesterIdle;
+        return result;
+    } else {
+        manchester_error(dec);
+        return 0;
+    }
+
+    // Follow clock drift within the packet
+    dec->half_ticks = (dec->half_ticks * 3 + ticks / halves) / 4;
+
+    while (halves--) {
+        result |= manchester_half(dec, level, data);
+        if (dec->state != kSwoManchesterData) {
+            break;
+        }
+    }
+    return result;
+}
+
+void swo_autobaud_init(swo_autobaud_t *ab)
+{
+    ab->min_ticks = UINT32_MAX;
+    ab->sum_ticks = 0;
+    ab->count = 0;
+    ab->edges = 0;
+}
+
+void swo_autobaud_put(swo_autobaud_t *ab, uint32_t ticks)
+{
+    if (ticks == 0) {
+        return;
+    }
+    ab->edges++;
+    if (ticks < ab->min_ticks) {
+        ab->min_ticks = ticks;
+    }
+
+    // Compare with the average of the shortest pulses rather than the minimum,
+    // which edge jitter pulls below the real pulse length
+    if ((ab->count == 0) || ((uint64_t)ticks * 8 * ab->count < (uint64_t)ab->sum_ticks * 7)) {
+        // Clearly shorter than the pulses seen so far, restart the average
+        ab->sum_ticks = ticks;
+        ab->count = 1;
+    } else if ((uint64_t)ticks * 8 * ab->count <= (uint64_t)ab->sum_ticks * 9) {
+        // Within 12.5% of the average, add it in
+        ab->sum_ticks += ticks;
+        ab->count++;
+    }
+}
+
+uint32_t swo_autobaud_get(const swo_autobaud_t *ab, uint32_t clock, uint32_t pulses_per_bit)
+{
+    uint64_t bit_ticks;
+
+    if ((ab->edges < SWO_AUTOBAUD_EDGES) || (ab->count == 0) || (pulses_per_bit == 0)) {
+        return 0;
+    }
+
+    // Bit length in ticks scaled by count to keep the fractional part of the average
+    bit_ticks = (uint64_t)ab->sum_ticks * pulses_per_bit;
+    return (uint32_t)(((uint64_t)clock * ab->count + bit_ticks / 2) / bit_ticks);
+}
@@ -0,0 +1,134 @@
+/**
+ * @file    swo_decode.h
+ * @brief   SWO Manchester decoder and baudrate detection
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2021, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SWO_DECODE_H
+#define SWO_DECODE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! @brief Measure the SWO baudrate when the host requests a baudrate of 0.
+//!
+//! Requires the HIC to implement the swo_capture_*() hooks below.
+#ifndef SWO_AUTOBAUD
+#define SWO_AUTOBAUD            0
+#endif
+
+//! @brief Number of pulses that must be seen before a baudrate is reported.
+#ifndef SWO_AUTOBAUD_EDGES
+#define SWO_AUTOBAUD_EDGES      64U
+#endif
+
+//! @brief Maximum time in ms to wait for SWO_AUTOBAUD_EDGES pulses.
+#ifndef SWO_AUTOBAUD_TIMEOUT
+#define SWO_AUTOBAUD_TIMEOUT    500U
+#endif
+
+//! @brief Minimum number of capture timer ticks per Manchester half-bit.
+#define SWO_MANCHESTER_MIN_TICKS    4U
+
+typedef enum {
+    kSwoManchesterSync,         //!< Waiting for the line to go idle
+    kSwoManchesterIdle,         //!< Line idle, waiting for a start bit
+    kSwoManchesterData,         //!< Receiving a packet
+} swo_manchester_state_t;
+
+typedef struct {
+    uint32_t nominal_ticks;     //!< Expected half-bit length from the configured baudrate
+    uint32_t half_ticks;        //!< Half-bit length tracked over the current packet
+    uint32_t errors;            //!< Number of malformed packets seen
+    uint8_t state;              //!< One of swo_manchester_state_t
+    uint8_t start;              //!< Start bit has not been completed yet
+    uint8_t half;               //!< Next half belongs to the second half of a bit
+    uint8_t first;              //!< Level of the first half of the current bit
+    uint8_t shift;              //!< Data bits received so far, LSB first
+    uint8_t bits;               //!< Number of data bits in shift
+} swo_manchester_t;
+
+typedef struct {
+    uint32_t min_ticks;         //!< Shortest pulse seen so far
+    uint32_t sum_ticks;         //!< Sum of pulses close to their own average
+    uint32_t count;             //!< Number of pulses in sum_ticks
+    uint32_t edges;             //!< Total number of pulses seen
+} swo_autobaud_t;
+
+/*!
+ * @brief Reset the Manchester decoder.
+ *
+ * @param dec Decoder instance.
+ * @param nominal_ticks Expected half-bit length in timer ticks, used to recognize
+ *      the idle line before the first packet. Pass 0 to accept any low level as idle.
+ */
+void swo_manchester_init(swo_manchester_t *dec, uint32_t nominal_ticks);
+
+/*!
+ * @brief Feed one level period of the SWO line into the decoder.
+ *
+ * The line is idle low. Each packet starts with a 1 start bit, a 1 is encoded as
+ * high followed by low and data is sent LSB first. The half-bit length is measured
+ * from the start bit of every packet and tracked over the packet, so the target
+ * clock may drift between and during packets.
+ *
+ * @param dec Decoder instance.
+ * @param level Line level during the period that just ended (0 or 1).
+ * @param ticks Length of the period in timer ticks.
+ * @param data Receives the decoded byte.
+ * @return 1 if a byte was completed and stored in data, 0 otherwise.
+ */
+uint32_t swo_manchester_decode(swo_manchester_t *dec, uint32_t level, uint32_t ticks, uint8_t *data);
+
+//! @brief Reset the baudrate detector.
+void swo_autobaud_init(swo_autobaud_t *ab);
+
+//! @brief Add the length in timer ticks of one level period of the SWO line.
+void swo_autobaud_put(swo_autobaud_t *ab, uint32_t ticks);
+
+/*!
+ * @brief Get the detected baudrate.
+ *
+ * @param ab Detector instance.
+ * @param clock Capture timer clock in Hz.
+ * @param pulses_per_bit Shortest pulses per bit, 1 for UART and 2 for Manchester.
+ * @return Baudrate in Hz, or 0 if not enough pulses have been seen yet.
+ */
+uint32_t swo_autobaud_get(const swo_autobaud_t *ab, uint32_t clock, uint32_t pulses_per_bit);
+
+/*!
+ * @brief HIC hooks for timer capture on the SWO pin.
+ *
+ * swo_capture_init() prepares the timer and returns its clock in Hz, or 0 if edge
+ * capture is not supported. It may be called more than once. While enabled with
+ * swo_capture_control(), the HIC calls swo_capture_edge() from its capture interrupt
+ * on every SWO edge with the level and length of the period that just ended.
+ */
+uint32_t swo_capture_init(void);
+void swo_capture_uninit(void);
+void swo_capture_control(uint32_t enable);
+void swo_capture_edge(uint32_t level, uint32_t ticks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
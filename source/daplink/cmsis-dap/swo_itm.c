@@ -0,0 +1,133 @@
+/**
+ * @file    swo_itm.c
+ * @brief   ITM/DWT packet filter for SWO trace data
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2021, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "swo_itm.h"
+
+// Packet headers, see the ARMv7-M Architecture Reference Manual, Appendix D4
+#define ITM_SYNC_END            0x80U
+#define ITM_OVERFLOW            0x70U
+#define ITM_CONTINUE            0x80U
+#define ITM_DWT_PC_SAMPLE       2U
+
+void swo_itm_filter_init(swo_itm_filter_t *filter, uint8_t keep_types, uint32_t keep_ports, uint32_t route_ports)
+{
+    filter->keep_types = keep_types & SWO_ITM_KEEP_ALL;
+    filter->keep_ports = keep_ports;
+    filter->route_ports = route_ports;
+    filter->enabled = (filter->keep_types != SWO_ITM_KEEP_ALL) ||
+                      (keep_ports != 0xFFFFFFFFU) ||
+                      (route_ports != 0);
+    swo_itm_filter_reset(filter);
+}
+
+void swo_itm_filter_reset(swo_itm_filter_t *filter)
+{
+    filter->remaining = 0;
+    filter->cont = 0;
+    filter->keep = 0;
+    filter->route = 0;
+    filter->port = 0;
+    filter->zeros = 0;
+}
+
+// Decode a packet header and set up the parser for its payload
+static void itm_header(swo_itm_filter_t *filter, uint8_t header)
+{
+    uint8_t type;
+    uint8_t size;
+
+    filter->route = 0;
+
+    if (header == 0) {
+        filter->zeros++;
+        filter->keep = (filter->keep_types & SWO_ITM_KEEP_PROTOCOL) != 0;
+        return;
+    }
+    if ((header == ITM_SYNC_END) && (filter->zeros != 0)) {
+        filter->zeros = 0;
+        filter->keep = (filter->keep_types & SWO_ITM_KEEP_PROTOCOL) != 0;
+        return;
+    }
+    filter->zeros = 0;
+
+    size = header & 0x03U;
+    if (size != 0) {
+        // Source packet with 1, 2 or 4 payload bytes
+        filter->remaining = (size == 3) ? 4 : size;
+        filter->port = header >> 3;
+        if (header & 0x04U) {
+            type = (filter->port == ITM_DWT_PC_SAMPLE) ? SWO_ITM_KEEP_PC_SAMPLE : SWO_ITM_KEEP_HWIT;
+            filter->keep = (filter->keep_types & type) != 0;
+        } else {
+            filter->keep = ((filter->keep_types & SWO_ITM_KEEP_SWIT) != 0) &&
+                           ((filter->keep_ports & (1UL << filter->port)) != 0);
+            filter->route = (filter->route_ports & (1UL << filter->port)) != 0;
+        }
+        return;
+    }
+
+    if (header == ITM_OVERFLOW) {
+        type = SWO_ITM_KEEP_PROTOCOL;
+    } else if ((header & 0x0FU) == 0x00U) {
+        // Local timestamp
+        type = SWO_ITM_KEEP_TIMESTAMP;
+    } else if ((header & 0xDFU) == 0x94U) {
+        // Global timestamp
+        type = SWO_ITM_KEEP_TIMESTAMP;
+    } else {
+        // Extension or reserved
+        type = SWO_ITM_KEEP_PROTOCOL;
+    }
+    filter->keep = (filter->keep_types & type) != 0;
+    filter->cont = (header & ITM_CONTINUE) != 0;
+}
+
+uint32_t swo_itm_filter(swo_itm_filter_t *filter, uint8_t *dst, const uint8_t *src, uint32_t size)
+{
+    uint32_t out = 0;
+    uint32_t i;
+    uint8_t data;
+
+    if (!filter->enabled) {
+        for (i = 0; (i < size) && (dst != src); i++) {
+            dst[i] = src[i];
+        }
+        return size;
+    }
+
+    for (i = 0; i < size; i++) {
+        data = src[i];
+        if (filter->remaining) {
+            filter->remaining--;
+            if (filter->route) {
+                swo_itm_route(filter->port, data);
+            }
+        } else if (filter->cont) {
+            filter->cont = (data & ITM_CONTINUE) != 0;
+        } else {
+            itm_header(filter, data);
+        }
+        if (filter->keep) {
+            dst[out++] = data;
+        }
+    }
+    return out;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file    swo_itm.h
+ * @brief   ITM/DWT packet filter for SWO trace data
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2021, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SWO_ITM_H
+#define SWO_ITM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! @brief Build the on-probe ITM packet filter into SWO capture.
+#ifndef SWO_ITM_FILTER
+#define SWO_ITM_FILTER          1
+#endif
+
+//! @name Packet types kept in the trace buffer
+//@{
+#define SWO_ITM_KEEP_SWIT       (1U << 0)   //!< Instrumentation (stimulus port) packets
+#define SWO_ITM_KEEP_PC_SAMPLE  (1U << 1)   //!< DWT periodic PC sample packets
+#define SWO_ITM_KEEP_HWIT       (1U << 2)   //!< Other DWT hardware source packets
+#define SWO_ITM_KEEP_TIMESTAMP  (1U << 3)   //!< Local and global timestamp packets
+#define SWO_ITM_KEEP_PROTOCOL   (1U << 4)   //!< Synchronization, overflow and extension packets
+#define SWO_ITM_KEEP_ALL        (0x1FU)
+//@}
+
+typedef struct {
+    uint8_t enabled;            //!< Filter active, otherwise data passes through untouched
+    uint8_t keep_types;         //!< SWO_ITM_KEEP_* mask
+    uint32_t keep_ports;        //!< Stimulus ports kept in the trace buffer
+    uint32_t route_ports;       //!< Stimulus ports whose payload goes to swo_itm_route()
+    // Parser state
+    uint8_t remaining;          //!< Fixed-size payload bytes still expected
+    uint8_t cont;               //!< Payload continues while bit 7 is set
+    uint8_t keep;               //!< Current packet is copied to the output
+    uint8_t route;              //!< Current packet payload is routed
+    uint8_t port;               //!< Stimulus port of the current packet
+    uint8_t zeros;              //!< Consecutive zero bytes of a synchronization packet
+} swo_itm_filter_t;
+
+/*!
+ * @brief Configure the filter and reset the parser.
+ *
+ * Setting keep_types to SWO_ITM_KEEP_ALL with all ports kept and none routed
+ * disables the filter.
+ */
+void swo_itm_filter_init(swo_itm_filter_t *filter, uint8_t keep_types, uint32_t keep_ports, uint32_t route_ports);
+
+//! @brief Reset the parser, keeping the filter configuration.
+void swo_itm_filter_reset(swo_itm_filter_t *filter);
+
+/*!
+ * @brief Filter raw SWO data.
+ *
+ * Packets may span calls. dst may be equal to src since the output never
+ * runs ahead of the input.
+ *
+ * @return Number of bytes written to dst.
+ */
+uint32_t swo_itm_filter(swo_itm_filter_t *filter, uint8_t *dst, const uint8_t *src, uint32_t size);
+
+//! @brief Receives the payload of routed stimulus ports, one byte at a time.
+void swo_itm_route(uint8_t port, uint8_t data);
+
+//! @brief Process the ID_DAP_SWO_ITMFilter vendor command, see daplink_vendor_commands.h.
+uint32_t SWO_ITMFilter(const uint8_t *request, uint8_t *response);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
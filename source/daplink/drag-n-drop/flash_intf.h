@@ -57,6 +57,10 @@ typedef struct {
     flash_erase_sector_size_cb_t erase_sector_size;
     flash_busy_cb_t flash_busy;
     flash_algo_set_cb_t flash_algo_set;
+    // Optional, starts erasing a sector and returns while the erase runs.
+    // The next call that needs the flash waits for it to finish, so this only
+    // helps an interface that can buffer the sector's data meanwhile.
+    flash_intf_erase_sector_cb_t erase_sector_start;
 } flash_intf_t;
 
 // All flash interfaces.  Unsupported interfaces are NULL.
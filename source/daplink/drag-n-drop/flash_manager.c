@@ -36,6 +36,15 @@
 #define flash_manager_printf(...)
 #endif
 
+// Set to 0 to wait for each sector erase before accepting data for the sector.
+// Otherwise the erase of the sector about to be written, not the next one,
+// runs while its data is received and only programming waits for it. This
+// needs an erase_sector_start() that can buffer the data meanwhile, which
+// target_flash only does when it stages the sector in target RAM.
+#ifndef FLASH_MANAGER_ERASE_AHEAD
+#define FLASH_MANAGER_ERASE_AHEAD   1
+#endif
+
 typedef enum {
     STATE_CLOSED,
     STATE_OPEN,
@@ -331,8 +340,12 @@ static error_t setup_next_sector(uint32_t addr)
     }
 
     if (page_erase_enabled) {
-        // Erase the current sector
-        status = intf->erase_sector(current_sector_addr);
+        // Erase the current sector, overlapping the reception of its data
+        if (FLASH_MANAGER_ERASE_AHEAD && intf->erase_sector_start) {
+            status = intf->erase_sector_start(current_sector_addr);
+        } else {
+            status = intf->erase_sector(current_sector_addr);
+        }
         flash_manager_printf("    intf->erase_sector(addr=0x%x) ret=%i\r\n", current_sector_addr);
         if (ERROR_SUCCESS != status) {
             intf->uninit();
@@ -38,6 +38,9 @@
 #include "cortex_m.h"
 #include "target_board.h"
 #include "flash_manager.h"
+#if defined(DAPLINK_IF)
+#include "swd_host.h"       // for swd_get_preattach_idcode
+#endif
 
 //! @brief Size in bytes of the virtual disk.
 //!
@@ -114,12 +117,18 @@ static uint32_t read_file_assert_txt(uint32_t sector_offset, uint8_t *data, uint
 static uint32_t read_file_need_bl_txt(uint32_t sector_offset, uint8_t *data, uint32_t num_sectors);
 
 static uint32_t update_details_txt_file(uint8_t *data, uint32_t datasize, uint32_t start);
+static uint32_t update_mbed_htm_file(uint8_t *buf, uint32_t size, uint32_t start);
 static void erase_target(void);
 
 static uint32_t expand_info(uint8_t *buf, uint32_t bufsize);
 
 __WEAK void vfs_user_build_filesystem_hook(){}
 
+__WEAK uint32_t vfs_user_details_hook(uint8_t *buf, uint32_t size, uint32_t start, uint32_t pos)
+{
+    return 0;
+}
+
 void vfs_user_build_filesystem()
 {
     uint32_t file_size;
@@ -356,41 +365,118 @@ uint32_t hex32_field_in_region(uint8_t *buf, uint32_t size, uint32_t start, uint
     return string_field_in_region(buf, size, start, pos, label, hex);
 }
 
-// File callback to be used with vfs_add_file to return file contents
-static uint32_t read_file_mbed_htm(uint32_t sector_offset, uint8_t *buf, uint32_t num_sectors)
+//! @brief Size in bytes of the buffer holding rendered MBED.HTM and DETAILS.TXT.
+//!
+//! Set in the HIC yaml where RAM allows it. Files that do not fit, and all
+//! files when it is 0, are rendered again on every read.
+#ifndef VFS_USER_RENDER_CACHE_SIZE
+#define VFS_USER_RENDER_CACHE_SIZE 0
+#endif
+
+//! @brief Rendered contents of a generated file.
+typedef struct _render_cache {
+    uint32_t (*render)(uint8_t *buf, uint32_t size, uint32_t start);
+    bool valid;         //!< Rendered for the current render_key.
+    uint32_t size;      //!< Size of the file.
+    uint8_t *data;      //!< Contents inside render_buf, or NULL if they did not fit.
+} render_cache_t;
+
+static render_cache_t mbed_htm_cache = { update_mbed_htm_file };
+static render_cache_t details_txt_cache = { update_details_txt_file };
+static volatile uint32_t details_generation;
+
+#if VFS_USER_RENDER_CACHE_SIZE
+//! @brief Everything the generated files depend on that can change at runtime.
+typedef struct _render_key {
+    uint32_t config_generation;
+    uint32_t details_generation;
+    uint32_t remount_count;
+    error_t transfer_status;
+} render_key_t;
+
+static render_key_t render_key;
+static uint32_t render_buf_used;
+static uint8_t render_buf[VFS_USER_RENDER_CACHE_SIZE];
+
+static void render_cache_check(void)
+{
+    render_key_t key;
+
+    memset(&key, 0, sizeof(key));
+    key.config_generation = config_get_generation();
+    key.details_generation = details_generation;
+    key.remount_count = remount_count;
+    key.transfer_status = vfs_mngr_get_transfer_status();
+    if (memcmp(&key, &render_key, sizeof(key)) != 0) {
+        render_key = key;
+        render_buf_used = 0;
+        mbed_htm_cache.valid = false;
+        details_txt_cache.valid = false;
+    }
+}
+
+// Serve a file read from the render cache, rendering the file once per change of render_key
+static uint32_t read_rendered_file(render_cache_t *cache, uint32_t sector_offset, uint8_t *data, uint32_t num_sectors)
 {
     uint32_t start = sector_offset * VFS_SECTOR_SIZE;
     uint32_t size = num_sectors * VFS_SECTOR_SIZE;
-    uint32_t pos = 0;
+    uint32_t free_size;
 
-    if ((sector_offset != 0) && (buf != NULL)) {
+    render_cache_check();
+    if ((data == NULL) && !cache->valid) {
+        // Only the size is needed, which does not depend on CRC values
+        return cache->render(NULL, 0, 0);
+    }
+    if (!cache->valid) {
+        free_size = sizeof(render_buf) - render_buf_used;
+        cache->size = cache->render(render_buf + render_buf_used, free_size, 0);
+        if (cache->size <= free_size) {
+            cache->data = render_buf + render_buf_used;
+            render_buf_used += cache->size;
+        } else {
+            cache->data = NULL;
+        }
+        cache->valid = true;
+    }
+
+    if (data == NULL) {
+        return cache->size;
+    }
+    if (cache->data == NULL) {
+        return cache->render(data, size, start);
+    }
+    if (start >= cache->size) {
         return 0;
     }
+    size = MIN(size, cache->size - start);
+    memcpy(data, cache->data + start, size);
+    return size;
+}
+#else
+static uint32_t read_rendered_file(render_cache_t *cache, uint32_t sector_offset, uint8_t *data, uint32_t num_sectors)
+{
+    if (data == NULL) {
+        return cache->render(NULL, 0, 0);
+    }
+    return cache->render(data, num_sectors * VFS_SECTOR_SIZE, sector_offset * VFS_SECTOR_SIZE);
+}
+#endif
 
-    pos += util_write_string_in_region(buf, size, start, pos,
-        "<!doctype html>\r\n"
-        "<!-- mbed Platform Website and Authentication Shortcut -->\r\n"
-        "<html>\r\n"
-        "<head>\r\n"
-        "<meta charset=\"utf-8\">\r\n"
-        "<title>mbed Website Shortcut</title>\r\n"
-        "</head>\r\n"
-        "<body>\r\n"
-        "<script>\r\n"
-        "window.location.replace(\"");
-    pos += expand_string_in_region(buf, size, start, pos, "@R");
-    pos += util_write_string_in_region(buf, size, start, pos, "\");\r\n"
-        "</script>\r\n"
-        "</body>\r\n"
-        "</html>\r\n");
+void vfs_user_details_changed(void)
+{
+    details_generation++;
+}
 
-    return pos;
+// File callback to be used with vfs_add_file to return file contents
+static uint32_t read_file_mbed_htm(uint32_t sector_offset, uint8_t *data, uint32_t num_sectors)
+{
+    return read_rendered_file(&mbed_htm_cache, sector_offset, data, num_sectors);
 }
 
 // File callback to be used with vfs_add_file to return file contents
 static uint32_t read_file_details_txt(uint32_t sector_offset, uint8_t *data, uint32_t num_sectors)
 {
-    return update_details_txt_file(data, num_sectors * VFS_SECTOR_SIZE, sector_offset * VFS_SECTOR_SIZE);
+    return read_rendered_file(&details_txt_cache, sector_offset, data, num_sectors);
 }
 
 // Text representation of each error type, starting from the rightmost bit
@@ -511,12 +597,54 @@ static uint32_t read_file_need_bl_txt(uint32_t sector_offset, uint8_t *data, uin
 #define COMPILER_DESCRIPTION "gcc"
 #endif
 
+#if defined(DAPLINK_IF)
+// Text representation of each boot phase
+static const char* const boot_phase_names[] = {
+    "config",
+    "gpio",
+    "dap",
+    "board",
+    "family",
+    "info",
+    "bl_update",
+    "usb_init",
+    "connect",
+    "configured"
+};
+
+COMPILER_ASSERT(ARRAY_SIZE(boot_phase_names) == kBootPhaseCount);
+#endif
+
 #if (GIT_LOCAL_MODS)
 #define LOCAL_MODS ", local mods"
 #else
 #define LOCAL_MODS ""
 #endif
 
+static uint32_t update_mbed_htm_file(uint8_t *buf, uint32_t size, uint32_t start)
+{
+    uint32_t pos = 0;
+
+    pos += util_write_string_in_region(buf, size, start, pos,
+        "<!doctype html>\r\n"
+        "<!-- mbed Platform Website and Authentication Shortcut -->\r\n"
+        "<html>\r\n"
+        "<head>\r\n"
+        "<meta charset=\"utf-8\">\r\n"
+        "<title>mbed Website Shortcut</title>\r\n"
+        "</head>\r\n"
+        "<body>\r\n"
+        "<script>\r\n"
+        "window.location.replace(\"");
+    pos += expand_string_in_region(buf, size, start, pos, "@R");
+    pos += util_write_string_in_region(buf, size, start, pos, "\");\r\n"
+        "</script>\r\n"
+        "</body>\r\n"
+        "</html>\r\n");
+
+    return pos;
+}
+
 static uint32_t update_details_txt_file(uint8_t *buf, uint32_t size, uint32_t start)
 {
     uint32_t pos = 0;
@@ -589,16 +717,45 @@ static uint32_t update_details_txt_file(uint8_t *buf, uint32_t size, uint32_t st
 #if DAPLINK_ROM_BL_SIZE != 0
     // CRC of the bootloader (if there is one)
     if (info_get_bootloader_present()) {
-        pos += hex32_field_in_region(buf, size, start, pos, "Bootloader CRC", info_get_crc_bootloader());
+        pos += hex32_field_in_region(buf, size, start, pos, "Bootloader CRC", buf ? info_get_crc_bootloader() : 0);
     }
 #endif
 
     // CRC of the interface
-    pos += hex32_field_in_region(buf, size, start, pos, "Interface CRC", info_get_crc_interface());
+    // CRCs may still be pending when only the size is requested
+    pos += hex32_field_in_region(buf, size, start, pos, "Interface CRC", buf ? info_get_crc_interface() : 0);
 
     // Number of remounts that have occurred
     pos += uint32_field_in_region(buf, size, start, pos, "Remount count", remount_count);
 
+#if defined(DAPLINK_IF)
+    // Debug port IDCODE found by the pre-attach, 0 if no target answered
+    {
+        uint32_t idcode = 0;
+        swd_get_preattach_idcode(&idcode);
+        pos += hex32_field_in_region(buf, size, start, pos, "Target IDCODE", idcode);
+    }
+
+    // Startup profile, fixed width since phases may still complete after the file size is taken
+    {
+        uint32_t times[kBootPhaseCount];
+        uint8_t count = config_ram_get_boot_times(times, kBootPhaseCount);
+        uint8_t i;
+        pos += util_write_string_in_region(buf, size, start, pos, "Boot profile (us):");
+        for (i = 0; i < kBootPhaseCount; i++) {
+            char number[9] = { '=' };
+            util_write_uint32_zp(number + 1, (i < count) ? MIN(times[i], 9999999) : 0, 7);
+            number[8] = 0;
+            pos += util_write_in_region(buf, size, start, pos, " ", 1);
+            pos += util_write_string_in_region(buf, size, start, pos, boot_phase_names[i]);
+            pos += util_write_string_in_region(buf, size, start, pos, number);
+        }
+        pos += util_write_in_region(buf, size, start, pos, "\r\n", 2);
+    }
+#endif
+
+    pos += vfs_user_details_hook(buf, size, start, pos);
+
     //Target URL
     pos += expand_string_in_region(buf, size, start, pos, "URL: @R\r\n");
 
@@ -54,6 +54,24 @@ bool vfs_user_file_change_handler_hook(const vfs_filename_t filename,
 //! @retval false The hook did not handle the file; continue with canonical behaviour.
 bool vfs_user_magic_file_hook(const vfs_filename_t filename, bool *do_remount);
 
+//! @brief Hook for board specific lines in DETAILS.TXT.
+//!
+//! Lines are written with the util_write_*_in_region() functions. The output should keep the
+//! same length while the drive is mounted, since the file size is only taken once.
+//!
+//! @param buf Region being rendered, NULL when only the file size is requested.
+//! @param size Size of the region.
+//! @param start File offset of the region.
+//! @param pos File offset to write at.
+//! @return Number of bytes written.
+uint32_t vfs_user_details_hook(uint8_t *buf, uint32_t size, uint32_t start, uint32_t pos);
+
+//! @brief Render DETAILS.TXT again on its next read.
+//!
+//! Call when what vfs_user_details_hook() writes has changed, otherwise a cached copy may be
+//! served until the next remount.
+void vfs_user_details_changed(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -47,6 +47,7 @@ static uint32_t hic_id = DAPLINK_HIC_ID;
 static uint32_t crc_bootloader;
 static uint32_t crc_interface;
 static uint32_t crc_config_user;
+static volatile bool crc_valid;
 
 // Strings
 static char string_unique_id[48 + 1];
@@ -187,7 +188,8 @@ static void setup_string_descriptor()
 
 void info_init(void)
 {
-    info_crc_compute();
+    // CRCs are computed on first use or by info_crc_compute()
+    crc_valid = false;
     read_unique_id(host_id);
     setup_basics();
     setup_unique_id();
@@ -263,42 +265,64 @@ bool info_get_config_user_present(void)
     return false;
 }
 
+static void crc_check(void)
+{
+    if (!crc_valid) {
+        info_crc_compute();
+    }
+}
+
+bool info_crc_ready(void)
+{
+    return crc_valid;
+}
+
 uint32_t info_get_crc_bootloader()
 {
+    crc_check();
     return crc_bootloader;
 }
 
 uint32_t info_get_crc_interface()
 {
+    crc_check();
     return crc_interface;
 }
 
 uint32_t info_get_crc_config_user()
 {
+    crc_check();
     return crc_config_user;
 }
 
 void info_crc_compute()
 {
-    crc_bootloader = 0;
-    crc_interface = 0;
-    crc_config_user = 0;
+    // May run in a background thread while another thread reads the
+    // CRCs, so only publish complete results
+    uint32_t crc_bl = 0;
+    uint32_t crc_if = 0;
+    uint32_t crc_cfg = 0;
 
     // Compute the CRCs of regions that exist
     if ((DAPLINK_ROM_BL_SIZE > 0)
             && flash_is_readable(DAPLINK_ROM_BL_START, DAPLINK_ROM_BL_SIZE - 4)) {
-        crc_bootloader = crc32((void *)DAPLINK_ROM_BL_START, DAPLINK_ROM_BL_SIZE - 4);
+        crc_bl = crc32((void *)DAPLINK_ROM_BL_START, DAPLINK_ROM_BL_SIZE - 4);
     }
 
     if ((DAPLINK_ROM_IF_SIZE > 0)
             && flash_is_readable(DAPLINK_ROM_IF_START, DAPLINK_ROM_IF_SIZE - 4)) {
-        crc_interface = crc32((void *)DAPLINK_ROM_IF_START, DAPLINK_ROM_IF_SIZE - 4);
+        crc_if = crc32((void *)DAPLINK_ROM_IF_START, DAPLINK_ROM_IF_SIZE - 4);
     }
 
     if ((DAPLINK_ROM_CONFIG_USER_SIZE > 0)
             && flash_is_readable(DAPLINK_ROM_CONFIG_USER_START, DAPLINK_ROM_CONFIG_USER_SIZE)) {
-        crc_config_user = crc32((void *)DAPLINK_ROM_CONFIG_USER_START, DAPLINK_ROM_CONFIG_USER_SIZE);
+        crc_cfg = crc32((void *)DAPLINK_ROM_CONFIG_USER_START, DAPLINK_ROM_CONFIG_USER_SIZE);
     }
+
+    crc_bootloader = crc_bl;
+    crc_interface = crc_if;
+    crc_config_user = crc_cfg;
+    crc_valid = true;
 }
 
 // Get version info as an integer
@@ -31,7 +31,11 @@ extern "C" {
 
 void info_init(void);
 void info_set_uuid_target(uint32_t *uuid_data);
+// Compute the region CRCs. info_init() leaves them pending so this can run
+// in the background once USB is up.
 void info_crc_compute(void);
+// Check whether the region CRCs have been computed
+bool info_crc_ready(void);
 
 
 // Get the 48 digit unique ID as a null terminated string.
@@ -75,7 +79,8 @@ bool info_get_config_user_present(void);
 
 // Get the CRCs of various regions.
 // The CRC returned is only valid if
-// the given region is present.
+// the given region is present. If the CRCs
+// are still pending they are computed first.
 uint32_t info_get_crc_bootloader(void);
 uint32_t info_get_crc_interface(void);
 uint32_t info_get_crc_config_user(void);
@@ -46,6 +46,7 @@
 #else //DAPLINK_BOOTLOADER_UPDATE
     static const unsigned int image_start = 0;
     static const unsigned int image_size = 0;
+    static const unsigned int image_crc = 0;
     static const char image_data[1];
 #endif //DAPLINK_BOOTLOADER_UPDATE
 
@@ -79,15 +80,26 @@ void bootloader_check_and_update(void)
         return;
     }
 
-    if (!interface_image_valid()) {
-        // The interface is corrupt so don't attempt
-        // to apply the update
-        util_assert(0);
-        return;
+    if ((image_start == DAPLINK_ROM_BL_START) && (image_size == DAPLINK_ROM_BL_SIZE)) {
+        // Both images end with the CRC of the rest. A matching stored word
+        // alone could sit behind a partly programmed bootloader, so the
+        // contents must match it too. The CRC is kept for later readers.
+        same = flash_is_readable(DAPLINK_ROM_BL_START + DAPLINK_ROM_BL_SIZE - 4, 4) &&
+               (*(uint32_t *)(DAPLINK_ROM_BL_START + DAPLINK_ROM_BL_SIZE - 4) == image_crc) &&
+               (info_get_crc_bootloader() == image_crc);
+    } else {
+        same = memcmp((void*)image_start, image_data, image_size) == 0;
     }
-
-    same = memcmp((void*)image_start, image_data, image_size) == 0;
     if (!same) {
+        // This runs before usbd_init() and the crc thread, the CRCs are
+        // computed here on first use
+        if (!interface_image_valid()) {
+            // The interface is corrupt so don't attempt
+            // to apply the update
+            util_assert(0);
+            return;
+        }
+
         ret = flash_manager_init(flash_intf_iap_protected);
         if (ret != ERROR_SUCCESS) {
             util_assert(0);
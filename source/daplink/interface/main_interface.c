@@ -33,6 +33,7 @@
 #include "settings.h"
 #include "daplink.h"
 #include "util.h"
+#include "DAP_config.h"
 #include "DAP.h"
 #include "bootloader.h"
 #include "cortex_m.h"
@@ -128,6 +129,28 @@ static const osTimerAttr_t k_timer_30ms_attr = {
         .cb_mem = s_timer_30ms_cb,
         .cb_size = sizeof(s_timer_30ms_cb),
     };
+
+static uint32_t s_crc_thread_cb[WORDS(sizeof(osRtxThread_t))];
+static uint64_t s_crc_task_stack[CRC_TASK_STACK / sizeof(uint64_t)];
+static const osThreadAttr_t k_crc_thread_attr = {
+        .name = "crc",
+        .cb_mem = s_crc_thread_cb,
+        .cb_size = sizeof(s_crc_thread_cb),
+        .stack_mem = s_crc_task_stack,
+        .stack_size = sizeof(s_crc_task_stack),
+        .priority = CRC_TASK_PRIORITY,
+    };
+
+static uint32_t s_preattach_thread_cb[WORDS(sizeof(osRtxThread_t))];
+static uint64_t s_preattach_task_stack[PREATTACH_TASK_STACK / sizeof(uint64_t)];
+static const osThreadAttr_t k_preattach_thread_attr = {
+        .name = "preattach",
+        .cb_mem = s_preattach_thread_cb,
+        .cb_size = sizeof(s_preattach_thread_cb),
+        .stack_mem = s_preattach_task_stack,
+        .stack_size = sizeof(s_preattach_task_stack),
+        .priority = PREATTACH_TASK_PRIORITY,
+    };
 #endif
 
 // USB busy LED state; when TRUE the LED will flash once using 30mS clock tick
@@ -256,9 +279,116 @@ void main_usb_set_test_mode(bool enabled)
 
 void USBD_SignalHandler()
 {
+    usbd_signal();
     osThreadFlagsSet(main_task_id, FLAGS_MAIN_PROC_USB);
 }
 
+#if (USBD_EVENT_PROFILE)
+U32 usbd_event_timestamp(void)
+{
+    return TIMESTAMP_GET();
+}
+#endif
+
+// TIMESTAMP_GET() reads the DWT cycle counter, which only runs once enabled
+static void timestamp_init(void)
+{
+#if TIMESTAMP_CLOCK
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+#ifndef USE_LEGACY_CMSIS_RTOS
+static void crc_task(void * arg)
+{
+    info_crc_compute();
+    osThreadExit();
+}
+#endif
+
+// The region CRCs are not needed to enumerate so they are left until USB is up
+static void start_crc_compute(void)
+{
+#ifndef USE_LEGACY_CMSIS_RTOS
+    static bool started = false;
+
+    if (started || info_crc_ready()) {
+        return;
+    }
+    started = true;
+    osThreadNew(crc_task, NULL, &k_crc_thread_attr);
+#else
+    // No room for another thread and computing here would stall the main
+    // task, the first reader computes them instead
+#endif
+}
+
+static volatile bool preattach_running = false;
+
+#if SWD_PREATTACH && !defined(USE_LEGACY_CMSIS_RTOS)
+static void preattach_task(void * arg)
+{
+    swd_preattach();
+    preattach_running = false;
+    osThreadExit();
+}
+#endif
+
+// Attach to the target while USB is held disconnected for USB_CONNECT_DELAY.
+// Nothing else can use the debug port until the host connects.
+static void start_preattach(void)
+{
+#if !SWD_PREATTACH
+    // The target is not powered yet
+#elif !defined(USE_LEGACY_CMSIS_RTOS)
+    preattach_running = true;
+    if (osThreadNew(preattach_task, NULL, &k_preattach_thread_attr) == NULL) {
+        preattach_running = false;
+    }
+#else
+    // No room for another thread, attach from the main task instead
+    swd_preattach();
+#endif
+}
+
+// The main task must not touch the debug port while the pre-attach runs
+static void preattach_wait(void)
+{
+    while (preattach_running) {
+        osDelay(1);
+    }
+}
+
+static uint32_t boot_start;
+static bool boot_profile_done = false;
+
+// Time base of the boot profile, the OS tick is too coarse for the early phases
+static uint32_t boot_timestamp(void)
+{
+#if TIMESTAMP_CLOCK
+    return TIMESTAMP_GET();
+#else
+    return osKernelGetTickCount();
+#endif
+}
+
+// Record the end of a startup phase in the boot profile. Later USB reconnects are not recorded.
+static void boot_phase_done(boot_phase_t phase)
+{
+    uint32_t elapsed = boot_timestamp() - boot_start;
+
+    if (boot_profile_done) {
+        return;
+    }
+#if TIMESTAMP_CLOCK
+    config_ram_set_boot_time(phase, (uint32_t)((uint64_t)elapsed * 1000000 / TIMESTAMP_CLOCK));
+#else
+    config_ram_set_boot_time(phase, elapsed * (1000000 / osKernelGetTickFreq()));
+#endif
+    boot_profile_done = (phase == kBootPhaseConfigured);
+}
+
 extern void cdc_process_event(void);
 
 void main_task(void * arg)
@@ -276,8 +406,11 @@ void main_task(void * arg)
     uint8_t power_on = 1;
 #endif
 
+    timestamp_init();
+    boot_start = boot_timestamp();
     // Initialize settings - required for asserts to work
     config_init();
+    boot_phase_done(kBootPhaseConfig);
 
 #ifdef USE_LEGACY_CMSIS_RTOS
     // Get a reference to this task
@@ -289,8 +422,10 @@ void main_task(void * arg)
     gpio_set_hid_led(hid_led_value);
     gpio_set_cdc_led(cdc_led_value);
     gpio_set_msc_led(msc_led_value);
+    boot_phase_done(kBootPhaseGpio);
     // Initialize the DAP
     DAP_Setup();
+    boot_phase_done(kBootPhaseDap);
 
     // make sure we have a valid board info structure.
     util_assert(g_board_info.info_version == kBoardInfoVersion);
@@ -299,6 +434,7 @@ void main_task(void * arg)
     if (g_board_info.prerun_board_config) {
         g_board_info.prerun_board_config();
     }
+    boot_phase_done(kBootPhaseBoard);
 
     //initialize the family
     init_family();
@@ -306,6 +442,7 @@ void main_task(void * arg)
     if (g_target_family && g_target_family->prerun_target_config) {
         g_target_family->prerun_target_config();
     }
+    boot_phase_done(kBootPhaseFamily);
 
     //setup some flags
     if (g_board_info.flags & kEnableUnderResetConnect) {
@@ -319,14 +456,18 @@ void main_task(void * arg)
 
     // Update versions and IDs
     info_init();
+    boot_phase_done(kBootPhaseInfo);
     // Update bootloader if it is out of date
     bootloader_check_and_update();
+    boot_phase_done(kBootPhaseBootloaderUpdate);
     // USB
     usbd_init();
 #ifdef DRAG_N_DROP_SUPPORT
     vfs_mngr_fs_enable((config_ram_get_disable_msd()==0));
 #endif
     usbd_connect(0);
+    boot_phase_done(kBootPhaseUsbInit);
+    start_preattach();
     usb_state = USB_CONNECTING;
 
     // Start timer tasks
@@ -347,6 +488,8 @@ void main_task(void * arg)
                        | FLAGS_BOARD_EVENT          // custom board event
                        , osFlagsWaitAny
                        , osWaitForever);
+        // Board events, resets and USB requests may all use the debug port
+        preattach_wait();
 
         if (flags & FLAGS_MAIN_PROC_USB) {
             if (usb_test_mode) {
@@ -354,7 +497,7 @@ void main_task(void * arg)
                 // simulate worst-case behavior.
                 osDelay(1);
             }
-            USBD_Handler();
+            usbd_handler();
         }
 
         if (flags & FLAGS_MAIN_RESET) {
@@ -408,6 +551,7 @@ void main_task(void * arg)
                     if (DECZERO(usb_state_count) == 0) {
                         usbd_connect(1);
                         usb_state = USB_CHECK_CONNECTED;
+                        boot_phase_done(kBootPhaseConnect);
                         // Reset connect timeout
                         usb_no_config_count = USB_CONFIGURE_TIMEOUT;
                     }
@@ -420,6 +564,8 @@ void main_task(void * arg)
                         gpio_set_board_power(true);
 
                         usb_state = USB_CONNECTED;
+                        boot_phase_done(kBootPhaseConfigured);
+                        start_crc_compute();
                     }
                     else if (DECZERO(usb_no_config_count) == 0) {
                         // USB configuration timed out, which most likely indicates that the HIC is
@@ -427,6 +573,7 @@ void main_task(void * arg)
                         // board power.
                         gpio_set_board_power(true);
                         usb_state = USB_DISCONNECTED;
+                        start_crc_compute();
                     }
 
                     break;
@@ -0,0 +1,311 @@
+/**
+ * @file    rtt_bridge.c
+ * @brief   Bridge between the target's SEGGER RTT buffers and the CDC VCOM
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2021, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef RTT_CDC_BRIDGE
+
+#include <string.h>
+
+#include "cmsis_os2.h"
+#include "rl_usb.h"
+#include "rtt_bridge.h"
+#include "main_interface.h"
+#include "swd_host.h"
+#include "DAP_config.h"
+#include "DAP.h"
+#include "target_board.h"
+#include "util.h"
+#ifdef DRAG_N_DROP_SUPPORT
+#include "flash_intf.h"
+#endif
+
+// Layout of the SEGGER RTT control block, see SEGGER_RTT.h
+#define RTT_ID                  "SEGGER RTT"
+#define RTT_ID_SIZE             (16)
+#define RTT_CB_NUM_UP           (16)
+#define RTT_CB_UP_0             (24)
+#define RTT_BUFFER_DESC_SIZE    (24)
+#define RTT_DESC_WR_OFF         (12)
+#define RTT_DESC_RD_OFF         (16)
+#define RTT_MAX_BUFFERS         (32)
+
+typedef enum {
+    kRttDetached,               // Debug port not initialized by the bridge
+    kRttScan,                   // Looking for the control block
+    kRttActive,                 // Bridging channel 0
+    kRttGaveUp,                 // No control block found, wait for the target to change
+} rtt_state_t;
+
+typedef struct {
+    uint32_t name;
+    uint32_t buffer;
+    uint32_t size;
+    uint32_t wr_off;
+    uint32_t rd_off;
+    uint32_t flags;
+} rtt_buffer_desc_t;
+
+static rtt_state_t state = kRttDetached;
+static uint32_t next_poll;
+static uint32_t poll_interval;
+// Scan position
+static uint32_t scan_region;
+static uint32_t scan_addr;
+static uint32_t scan_misses;
+// Control block
+static uint32_t cb_addr;
+static uint32_t up_desc_addr;
+static uint32_t down_desc_addr;
+
+static uint8_t rtt_buffer[RTT_SCAN_CHUNK_SIZE + RTT_ID_SIZE];
+
+static void schedule(uint32_t ticks)
+{
+    next_poll = osKernelGetTickCount() + ticks;
+}
+
+static void detach(uint32_t retry_ticks)
+{
+    state = kRttDetached;
+    schedule(retry_ticks);
+}
+
+// The target may only be touched while nothing else is using the debug port
+static bool target_available(void)
+{
+    if (DAP_Data.debug_port != DAP_PORT_DISABLED) {
+        return false;
+    }
+#ifdef DRAG_N_DROP_SUPPORT
+    if (flash_intf_target->flash_busy()) {
+        return false;
+    }
+#endif
+    return (g_board_info.target_cfg != NULL);
+}
+
+static bool read_desc(uint32_t addr, rtt_buffer_desc_t *desc)
+{
+    if (!swd_read_memory(addr, (uint8_t *)desc, sizeof(*desc))) {
+        return false;
+    }
+    // Reject anything that does not look like a live buffer
+    return (desc->size != 0) && (desc->wr_off < desc->size) && (desc->rd_off < desc->size);
+}
+
+static void scan_start(void)
+{
+    state = kRttScan;
+    scan_region = 0;
+    scan_addr = g_board_info.target_cfg->ram_regions[0].start;
+}
+
+// Search one chunk of target RAM for the control block
+static void scan_step(void)
+{
+    const region_info_t *region;
+    uint32_t size;
+    uint32_t i;
+    uint32_t num[2];
+
+    region = &g_board_info.target_cfg->ram_regions[MIN(scan_region, MAX_REGIONS - 1)];
+    if ((scan_region >= MAX_REGIONS) || (region->end <= region->start)) {
+        // Nothing found, start over later since the target may not have set it up yet
+        scan_misses++;
+        if (scan_misses >= RTT_SCAN_MAX_MISSES) {
+            state = kRttGaveUp;
+            return;
+        }
+        scan_start();
+        schedule(RTT_RETRY_TICKS);
+        return;
+    }
+
+    if (scan_addr + RTT_ID_SIZE > region->end) {
+        scan_region++;
+        if (scan_region < MAX_REGIONS) {
+            scan_addr = g_board_info.target_cfg->ram_regions[scan_region].start;
+        }
+        return;
+    }
+
+    // Read RTT_ID_SIZE extra bytes so an ID straddling two chunks is found
+    size = MIN(sizeof(rtt_buffer), region->end - scan_addr);
+    if (!swd_read_memory(scan_addr, rtt_buffer, size)) {
+        detach(RTT_RETRY_TICKS);
+        return;
+    }
+
+    for (i = 0; i + sizeof(RTT_ID) <= size; i++) {
+        if ((rtt_buffer[i] == 'S') && (memcmp(&rtt_buffer[i], RTT_ID, sizeof(RTT_ID)) == 0)) {
+            if (!swd_read_memory(scan_addr + i + RTT_CB_NUM_UP, (uint8_t *)num, sizeof(num))) {
+                detach(RTT_RETRY_TICKS);
+                return;
+            }
+            if ((num[0] >= 1) && (num[0] <= RTT_MAX_BUFFERS) && (num[1] <= RTT_MAX_BUFFERS)) {
+                cb_addr = scan_addr + i;
+                up_desc_addr = cb_addr + RTT_CB_UP_0;
+                down_desc_addr = (num[1] != 0) ? up_desc_addr + num[0] * RTT_BUFFER_DESC_SIZE : 0;
+                poll_interval = 0;
+                scan_misses = 0;
+                state = kRttActive;
+                return;
+            }
+        }
+    }
+    scan_addr += RTT_SCAN_CHUNK_SIZE;
+    schedule(RTT_SCAN_STEP_TICKS);
+}
+
+// Copy target output to the host. Return the number of bytes moved or -1 on error.
+static int32_t poll_up(void)
+{
+    rtt_buffer_desc_t desc;
+    uint32_t n;
+
+    if (!read_desc(up_desc_addr, &desc)) {
+        return -1;
+    }
+
+    // Contiguous data only, the rest is picked up by the next poll
+    n = (desc.wr_off >= desc.rd_off) ? desc.wr_off - desc.rd_off : desc.size - desc.rd_off;
+    n = MIN(n, sizeof(rtt_buffer));
+    n = MIN(n, (uint32_t)USBD_CDC_ACM_DataFree());
+    if (n == 0) {
+        return 0;
+    }
+
+    if (!swd_read_memory(desc.buffer + desc.rd_off, rtt_buffer, n)) {
+        return -1;
+    }
+    USBD_CDC_ACM_DataSend(rtt_buffer, n);
+
+    desc.rd_off += n;
+    if (desc.rd_off >= desc.size) {
+        desc.rd_off = 0;
+    }
+    if (!swd_write_memory(up_desc_addr + RTT_DESC_RD_OFF, (uint8_t *)&desc.rd_off, sizeof(desc.rd_off))) {
+        return -1;
+    }
+    return n;
+}
+
+// Copy host input to the target. Return the number of bytes moved or -1 on error.
+static int32_t poll_down(void)
+{
+    rtt_buffer_desc_t desc;
+    uint32_t n;
+
+    if ((down_desc_addr == 0) || (USBD_CDC_ACM_DataAvailable() == 0)) {
+        return 0;
+    }
+    if (!read_desc(down_desc_addr, &desc)) {
+        return -1;
+    }
+
+    // Keep one byte free so a full buffer is distinguishable from an empty one
+    if (desc.rd_off > desc.wr_off) {
+        n = desc.rd_off - desc.wr_off - 1;
+    } else {
+        n = desc.size - desc.wr_off - (desc.rd_off == 0 ? 1 : 0);
+    }
+    n = MIN(n, sizeof(rtt_buffer));
+    if (n == 0) {
+        return 0;
+    }
+
+    n = USBD_CDC_ACM_DataRead(rtt_buffer, n);
+    if (n == 0) {
+        return 0;
+    }
+    if (!swd_write_memory(desc.buffer + desc.wr_off, rtt_buffer, n)) {
+        return -1;
+    }
+
+    desc.wr_off += n;
+    if (desc.wr_off >= desc.size) {
+        desc.wr_off = 0;
+    }
+    if (!swd_write_memory(down_desc_addr + RTT_DESC_WR_OFF, (uint8_t *)&desc.wr_off, sizeof(desc.wr_off))) {
+        return -1;
+    }
+    return n;
+}
+
+bool rtt_bridge_process(void)
+{
+    int32_t up;
+    int32_t down;
+
+    if (!target_available()) {
+        // Someone else drives the debug port and may reprogram or reset the target
+        state = kRttDetached;
+        scan_misses = 0;
+        return false;
+    }
+
+    if (state == kRttGaveUp) {
+        return false;
+    }
+
+    if ((int32_t)(osKernelGetTickCount() - next_poll) < 0) {
+        return (state == kRttActive);
+    }
+
+    switch (state) {
+        case kRttDetached:
+            if (!swd_init_debug()) {
+                detach(RTT_RETRY_TICKS);
+                return false;
+            }
+            scan_start();
+            return false;
+
+        case kRttScan:
+            scan_step();
+            return false;
+
+        case kRttActive:
+        default:
+            break;
+    }
+
+    up = poll_up();
+    down = (up >= 0) ? poll_down() : -1;
+    if ((up < 0) || (down < 0)) {
+        // Control block gone, most likely the target was reset
+        detach(0);
+        return false;
+    }
+
+    if ((up > 0) || (down > 0)) {
+        // Burst while data flows
+        main_blink_cdc_led(MAIN_LED_FLASH);
+        poll_interval = 0;
+    } else if (poll_interval < RTT_POLL_MAX_TICKS) {
+        // Back off while idle
+        poll_interval = (poll_interval == 0) ? 1 : poll_interval * 2;
+        poll_interval = MIN(poll_interval, RTT_POLL_MAX_TICKS);
+    }
+    schedule(poll_interval);
+    return true;
+}
+
+#endif
@@ -0,0 +1,82 @@
+/**
+ * @file    rtt_bridge.h
+ * @brief   Bridge between the target's SEGGER RTT buffers and the CDC VCOM
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2021, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RTT_BRIDGE_H
+#define RTT_BRIDGE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The bridge is built when RTT_CDC_BRIDGE is defined in the board yaml.
+
+//! @brief Bytes of target RAM read per scan step while looking for the control block.
+#ifndef RTT_SCAN_CHUNK_SIZE
+#define RTT_SCAN_CHUNK_SIZE     (256)
+#endif
+
+//! @brief Delay in OS ticks between two scan steps, bounds the SWD traffic of the search.
+#ifndef RTT_SCAN_STEP_TICKS
+#define RTT_SCAN_STEP_TICKS     (1)
+#endif
+
+//! @brief Full scans without finding the control block before the bridge stops searching.
+//!
+//! The search starts over once a debugger or drag-n-drop programming has used the target.
+#ifndef RTT_SCAN_MAX_MISSES
+#define RTT_SCAN_MAX_MISSES     (10)
+#endif
+
+//! @brief Longest poll interval in OS ticks once the RTT buffers are idle.
+#ifndef RTT_POLL_MAX_TICKS
+#define RTT_POLL_MAX_TICKS      (10)
+#endif
+
+//! @brief Delay in OS ticks before retrying after the target could not be accessed
+//! and between two full scans.
+#ifndef RTT_RETRY_TICKS
+#define RTT_RETRY_TICKS         (100)
+#endif
+
+/*!
+ * @brief Move data between RTT channel 0 and the CDC VCOM.
+ *
+ * Called from the main task whenever CDC is serviced. The bridge only touches the
+ * target while no debugger is connected over CMSIS-DAP and no drag-n-drop
+ * programming is in progress. It scans the target RAM regions for the
+ * _SEGGER_RTT control block one chunk per RTT_SCAN_STEP_TICKS, repeats the scan
+ * every RTT_RETRY_TICKS and gives up after RTT_SCAN_MAX_MISSES full scans. Once
+ * found, it polls the buffers with an interval that grows while they are idle and
+ * drops to zero while data flows.
+ *
+ * @return true if the bridge owns the CDC VCOM, in which case UART data is not
+ *      forwarded.
+ */
+bool rtt_bridge_process(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -22,6 +22,8 @@
  */
 
 #ifndef TARGET_MCU_CORTEX_A
+#include <string.h>
+
 #include "device.h"
 #include "cmsis_os2.h"
 #include "target_config.h"
@@ -29,6 +31,7 @@
 #include "DAP.h"
 #include "target_family.h"
 #include "swd_host.h"
+#include "util.h"
 
 // Default NVIC and Core debug base addresses
 // TODO: Read these addresses from ROM.
@@ -44,7 +47,6 @@
 #define REGWnR (1 << 16)
 
 #define MAX_SWD_RETRY 100//10
-#define MAX_TIMEOUT   1000000  // Timeout for syscalls on target
 
 // Use the CMSIS-Core definition if available.
 #if !defined(SCB_AIRCR_PRIGROUP_Pos)
@@ -55,6 +57,7 @@
 typedef struct {
     uint32_t select;
     uint32_t csw;
+    uint32_t tar;
 } DAP_STATE;
 
 typedef struct {
@@ -64,7 +67,39 @@ typedef struct {
 
 static SWD_CONNECT_TYPE reset_connect = CONNECT_NORMAL;
 
+// Core registers known to be held by the target between flash algo calls
+typedef struct {
+    uint8_t active;         // Algo session open, see swd_set_algo_session()
+    uint32_t valid;         // Bit n set when r[n] is known, bit 16 for xPSR
+    DEBUG_STATE state;
+} ALGO_SESSION;
+
+// Result of swd_preattach()
+typedef struct {
+    uint8_t attached;       // DP was left powered up, the next swd_init_debug() may reuse it
+    uint8_t valid;          // Target identified
+    uint32_t idcode;
+} PREATTACH_STATE;
+
+// Flash algo function started by swd_flash_syscall_start()
+typedef struct {
+    uint32_t entry;
+    uint32_t end;           // arg1 + arg2, returned by verify functions
+    uint32_t start;         // Tick count when it was started
+} ALGO_CALL;
+
+// Run time statistics of one flash algo function, in OS ticks
+typedef struct {
+    uint32_t entry;         // Entry point, 0 if the slot is unused
+    uint32_t calls;         // Completed calls
+    uint32_t avg_ticks;     // Moving average of the run time
+} ALGO_TIMING;
+
 static DAP_STATE dap_state;
+static ALGO_SESSION algo_session;
+static ALGO_CALL algo_call;
+static PREATTACH_STATE preattach;
+static ALGO_TIMING algo_timing[SWD_ALGO_TIMING_SLOTS];
 static uint32_t  soft_reset = SYSRESETREQ;
 
 static uint32_t swd_get_apsel(uint32_t adr)
@@ -190,6 +225,11 @@ uint8_t swd_read_ap(uint32_t adr, uint32_t *val)
         return 0;
     }
 
+    // DRW accesses may auto-increment TAR, so the cached value is stale
+    if ((adr & 0xFC) == AP_DRW) {
+        dap_state.tar = 0xffffffff;
+    }
+
     tmp_in = SWD_REG_AP | SWD_REG_R | SWD_REG_ADR(adr);
     // first dummy read
     swd_transfer_retry(tmp_in, (uint32_t *)tmp_out);
@@ -227,7 +267,19 @@ uint8_t swd_write_ap(uint32_t adr, uint32_t val)
             dap_state.csw = val;
             break;
 
+        case AP_TAR:
+            if (dap_state.tar == val) {
+                return 1;
+            }
+
+            dap_state.tar = val;
+            break;
+
         default:
+            // DRW accesses may auto-increment TAR, so the cached value is stale
+            if ((adr & 0xFC) == AP_DRW) {
+                dap_state.tar = 0xffffffff;
+            }
             break;
     }
 
@@ -263,7 +315,8 @@ static uint8_t swd_write_block(uint32_t address, uint8_t *data, uint32_t size)
         return 0;
     }
 
-    // TAR write
+    // TAR write, stale once the DRW access increments it
+    dap_state.tar = 0xffffffff;
     req = SWD_REG_AP | SWD_REG_W | (1 << 2);
     int2array(tmp_in, address, 4);
 
@@ -306,7 +359,8 @@ static uint8_t swd_read_block(uint32_t address, uint8_t *data, uint32_t size)
         return 0;
     }
 
-    // TAR write
+    // TAR write, stale once the DRW access increments it
+    dap_state.tar = 0xffffffff;
     req = SWD_REG_AP | SWD_REG_W | AP_TAR;
     int2array(tmp_in, address, 4);
 
@@ -343,7 +397,8 @@ static uint8_t swd_read_data(uint32_t addr, uint32_t *val)
     uint8_t tmp_out[4];
     uint8_t req, ack;
     uint32_t tmp;
-    // put addr in TAR register
+    // put addr in TAR register, stale once the DRW access increments it
+    dap_state.tar = 0xffffffff;
     int2array(tmp_in, addr, 4);
     req = SWD_REG_AP | SWD_REG_W | (1 << 2);
 
@@ -378,7 +433,8 @@ static uint8_t swd_write_data(uint32_t address, uint32_t data)
 {
     uint8_t tmp_in[4];
     uint8_t req, ack;
-    // put addr in TAR register
+    // put addr in TAR register, stale once the DRW access increments it
+    dap_state.tar = 0xffffffff;
     int2array(tmp_in, address, 4);
     req = SWD_REG_AP | SWD_REG_W | (1 << 2);
 
@@ -561,6 +617,129 @@ uint8_t swd_write_memory(uint32_t address, uint8_t *data, uint32_t size)
     return 1;
 }
 
+// DHCSR, DCRSR, DCRDR and DEMCR share a 16-byte aligned window. With TAR
+// pointing at it they are accessed through the MEM-AP banked data registers
+// BD0-BD3 without reprogramming TAR.
+#define DEBUG_WINDOW        DHCSR
+#define AP_BD(addr)         (AP_BD0 | ((addr) & 0x0C))
+
+static uint8_t swd_select_debug_window(void)
+{
+    if ((dap_state.csw == (CSW_VALUE | CSW_SIZE32)) && (dap_state.tar == DEBUG_WINDOW)) {
+        return 1;
+    }
+
+    if (!swd_write_ap(AP_CSW, CSW_VALUE | CSW_SIZE32)) {
+        return 0;
+    }
+
+    return swd_write_ap(AP_TAR, DEBUG_WINDOW);
+}
+
+// Read a register of the debug window.
+static uint8_t swd_read_debug_reg(uint32_t addr, uint32_t *val)
+{
+    if (!swd_select_debug_window()) {
+        return 0;
+    }
+
+    return swd_read_ap(AP_BD(addr), val);
+}
+
+// Write a register of the debug window.
+static uint8_t swd_write_debug_reg(uint32_t addr, uint32_t val)
+{
+    if (!swd_select_debug_window()) {
+        return 0;
+    }
+
+    return swd_write_ap(AP_BD(addr), val);
+}
+
+// Write an AP register without the trailing RDBUFF read. A fault is reported
+// by the ACK of a later transfer. The AP bank must already be selected.
+static uint8_t swd_write_ap_posted(uint32_t adr, uint32_t val)
+{
+    uint8_t data[4];
+    uint8_t req;
+
+    req = SWD_REG_AP | SWD_REG_W | SWD_REG_ADR(adr);
+    int2array(data, val, 4);
+    return (swd_transfer_retry(req, (uint32_t *)data) == 0x01);
+}
+
+// Same as swd_write_core_register() using posted writes, so only the
+// S_REGRDY poll waits for a result.
+static uint8_t swd_write_core_register_posted(uint32_t n, uint32_t val)
+{
+    uint8_t tmp_out[4];
+    uint8_t req;
+    int i, timeout = 100;
+
+    if (!swd_select_debug_window()) {
+        return 0;
+    }
+
+    if (!swd_write_dp(DP_SELECT, swd_get_apsel(AP_BD0) | (AP_BD0 & APBANKSEL))) {
+        return 0;
+    }
+
+    if (!swd_write_ap_posted(AP_BD(DCRDR), val) ||
+            !swd_write_ap_posted(AP_BD(DCRSR), n | REGWnR)) {
+        return 0;
+    }
+
+    // wait for S_REGRDY
+    for (i = 0; i < timeout; i++) {
+        req = SWD_REG_AP | SWD_REG_R | SWD_REG_ADR(AP_BD(DHCSR));
+
+        if (swd_transfer_retry(req, (uint32_t *)tmp_out) != 0x01) {
+            return 0;
+        }
+
+        req = SWD_REG_DP | SWD_REG_R | SWD_REG_ADR(DP_RDBUFF);
+
+        if (swd_transfer_retry(req, (uint32_t *)tmp_out) != 0x01) {
+            return 0;
+        }
+
+        if (tmp_out[2] & (S_REGRDY >> 16)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// Write one register of a debug state, skipping it when an open algo
+// session already left the same value in the target.
+static uint8_t swd_write_debug_register(uint32_t n, uint32_t val)
+{
+    if (algo_session.active && (algo_session.valid & (1UL << n))) {
+        if (((n == 16) ? algo_session.state.xpsr : algo_session.state.r[n]) == val) {
+            return 1;
+        }
+    }
+
+    if (!swd_write_core_register_posted(n, val)) {
+        algo_session.valid = 0;
+        return 0;
+    }
+
+    return 1;
+}
+
+void swd_set_algo_session(uint8_t active)
+{
+    algo_session.active = active;
+    algo_session.valid = 0;
+}
+
+void swd_invalidate_algo_session(void)
+{
+    algo_session.valid = 0;
+}
+
 // Execute system call.
 static uint8_t swd_write_debug_state(DEBUG_STATE *state)
 {
@@ -572,33 +751,33 @@ static uint8_t swd_write_debug_state(DEBUG_STATE *state)
 
     // R0, R1, R2, R3
     for (i = 0; i < 4; i++) {
-        if (!swd_write_core_register(i, state->r[i])) {
+        if (!swd_write_debug_register(i, state->r[i])) {
             return 0;
         }
     }
 
     // R9
-    if (!swd_write_core_register(9, state->r[9])) {
+    if (!swd_write_debug_register(9, state->r[9])) {
         return 0;
     }
 
     // R13, R14, R15
     for (i = 13; i < 16; i++) {
-        if (!swd_write_core_register(i, state->r[i])) {
+        if (!swd_write_debug_register(i, state->r[i])) {
             return 0;
         }
     }
 
     // xPSR
-    if (!swd_write_core_register(16, state->xpsr)) {
+    if (!swd_write_debug_register(16, state->xpsr)) {
         return 0;
     }
 
-    if (!swd_write_word(DBG_HCSR, DBGKEY | C_DEBUGEN | C_MASKINTS | C_HALT)) {
+    if (!swd_write_debug_reg(DBG_HCSR, DBGKEY | C_DEBUGEN | C_MASKINTS | C_HALT)) {
         return 0;
     }
 
-    if (!swd_write_word(DBG_HCSR, DBGKEY | C_DEBUGEN | C_MASKINTS)) {
+    if (!swd_write_debug_reg(DBG_HCSR, DBGKEY | C_DEBUGEN | C_MASKINTS)) {
         return 0;
     }
 
@@ -618,13 +797,13 @@ uint8_t swd_read_core_register(uint32_t n, uint32_t *val)
 {
     int i = 0, timeout = 100;
 
-    if (!swd_write_word(DCRSR, n)) {
+    if (!swd_write_debug_reg(DCRSR, n)) {
         return 0;
     }
 
     // wait for S_REGRDY
     for (i = 0; i < timeout; i++) {
-        if (!swd_read_word(DHCSR, val)) {
+        if (!swd_read_debug_reg(DHCSR, val)) {
             return 0;
         }
 
@@ -637,7 +816,7 @@ uint8_t swd_read_core_register(uint32_t n, uint32_t *val)
         return 0;
     }
 
-    if (!swd_read_word(DCRDR, val)) {
+    if (!swd_read_debug_reg(DCRDR, val)) {
         return 0;
     }
 
@@ -648,17 +827,20 @@ uint8_t swd_write_core_register(uint32_t n, uint32_t val)
 {
     int i = 0, timeout = 100;
 
-    if (!swd_write_word(DCRDR, val)) {
+    // The caller may change any register behind the algo session's back
+    algo_session.valid = 0;
+
+    if (!swd_write_debug_reg(DCRDR, val)) {
         return 0;
     }
 
-    if (!swd_write_word(DCRSR, n | REGWnR)) {
+    if (!swd_write_debug_reg(DCRSR, n | REGWnR)) {
         return 0;
     }
 
     // wait for S_REGRDY
     for (i = 0; i < timeout; i++) {
-        if (!swd_read_word(DHCSR, &val)) {
+        if (!swd_read_debug_reg(DHCSR, &val)) {
             return 0;
         }
 
@@ -670,28 +852,107 @@ uint8_t swd_write_core_register(uint32_t n, uint32_t val)
     return 0;
 }
 
-static uint8_t swd_wait_until_halted(void)
+// Find the statistics of a flash algo function, replacing the least used
+// slot for a new one.
+static ALGO_TIMING *swd_algo_timing_slot(uint32_t entry)
+{
+    ALGO_TIMING *slot = &algo_timing[0];
+    uint32_t i;
+
+    for (i = 0; i < SWD_ALGO_TIMING_SLOTS; i++) {
+        if (algo_timing[i].entry == entry) {
+            return &algo_timing[i];
+        }
+
+        if (algo_timing[i].calls < slot->calls) {
+            slot = &algo_timing[i];
+        }
+    }
+
+    memset(slot, 0, sizeof(*slot));
+    slot->entry = entry;
+    return slot;
+}
+
+static uint32_t swd_ms_to_ticks(uint32_t ms)
+{
+    uint32_t ticks = (uint32_t)(((uint64_t)ms * osKernelGetTickFreq() + 999) / 1000);
+    return ticks ? ticks : 1;
+}
+
+// Check whether the back-to-back polling window that began at spin_start
+// has passed. Without a timestamp timer it ends after one full OS tick.
+static uint8_t swd_spin_expired(uint32_t spin_start)
+{
+#if TIMESTAMP_CLOCK
+    return (TIMESTAMP_GET() - spin_start) >= (uint32_t)((uint64_t)SWD_HALT_SPIN_US * TIMESTAMP_CLOCK / 1000000);
+#else
+    return (osKernelGetTickCount() - spin_start) > 1;
+#endif
+}
+
+static uint32_t swd_spin_start(void)
+{
+#if TIMESTAMP_CLOCK
+    return TIMESTAMP_GET();
+#else
+    return osKernelGetTickCount();
+#endif
+}
+
+static uint8_t swd_wait_until_halted(ALGO_TIMING *timing, uint32_t start)
 {
     // Wait for target to stop
-    uint32_t val, i, timeout = MAX_TIMEOUT;
+    uint32_t val, elapsed, expected, delay, max_delay, timeout, spin_start;
+    uint8_t spinning = 1;
+
+    timeout = swd_ms_to_ticks(SWD_HALT_TIMEOUT_MS);
+    max_delay = swd_ms_to_ticks(SWD_HALT_POLL_MAX_MS);
+    delay = 1;
+
+    // Sleep through most of the run time seen so far instead of keeping
+    // SWD and the CPU busy, less what already passed since the start
+    if (timing->calls && (timing->avg_ticks > 1)) {
+        expected = timing->avg_ticks - timing->avg_ticks / 4;
+        elapsed = osKernelGetTickCount() - start;
+        if (elapsed < expected) {
+            osDelay(expected - elapsed);
+        }
+    }
 
-    for (i = 0; i < timeout; i++) {
-        if (!swd_read_word(DBG_HCSR, &val)) {
+    spin_start = swd_spin_start();
+
+    while (1) {
+        if (!swd_read_debug_reg(DBG_HCSR, &val)) {
             return 0;
         }
 
+        elapsed = osKernelGetTickCount() - start;
+
         if (val & S_HALT) {
+            timing->avg_ticks = timing->calls ? (timing->avg_ticks * 3 + elapsed) / 4 : elapsed;
+            timing->calls++;
             return 1;
         }
-    }
 
-    return 0;
+        if (elapsed > timeout) {
+            return 0;
+        }
+
+        // Poll back-to-back for short functions, then back off
+        if (spinning) {
+            spinning = !swd_spin_expired(spin_start);
+        } else {
+            osDelay(delay);
+            delay = MIN(delay * 2, max_delay);
+        }
+    }
 }
 
-uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, flash_algo_return_t return_type)
+uint8_t swd_flash_syscall_start(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4)
 {
     DEBUG_STATE state = {{0}, 0};
-    // Call flash algorithm function on target and wait for result.
+    // Call flash algorithm function on target, swd_flash_syscall_wait() collects the result.
     state.r[0]     = arg1;                   // R0: Argument 1
     state.r[1]     = arg2;                   // R1: Argument 2
     state.r[2]     = arg3;                   // R2: Argument 3
@@ -706,28 +967,46 @@ uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t e
         return 0;
     }
 
-    if (!swd_wait_until_halted()) {
+    // The algo follows the AAPCS, so SB and SP are preserved and the algo
+    // is trusted to return with the same xPSR state. The argument
+    // registers, LR and PC change.
+    algo_session.state = state;
+    algo_session.valid = (1UL << 9) | (1UL << 13) | (1UL << 16);
+
+    algo_call.entry = entry;
+    algo_call.end = arg1 + arg2;
+    algo_call.start = osKernelGetTickCount();
+    return 1;
+}
+
+uint8_t swd_flash_syscall_wait(flash_algo_return_t return_type)
+{
+    uint32_t r0;
+
+    if (!swd_wait_until_halted(swd_algo_timing_slot(algo_call.entry), algo_call.start)) {
+        algo_session.valid = 0;
         return 0;
     }
 
-    if (!swd_read_core_register(0, &state.r[0])) {
+    if (!swd_read_core_register(0, &r0)) {
+        algo_session.valid = 0;
         return 0;
     }
 
     //remove the C_MASKINTS
-    if (!swd_write_word(DBG_HCSR, DBGKEY | C_DEBUGEN | C_HALT)) {
+    if (!swd_write_debug_reg(DBG_HCSR, DBGKEY | C_DEBUGEN | C_HALT)) {
         return 0;
     }
 
     if ( return_type == FLASHALGO_RETURN_POINTER ) {
         // Flash verify functions return pointer to byte following the buffer if successful.
-        if (state.r[0] != (arg1 + arg2)) {
+        if (r0 != algo_call.end) {
             return 0;
         }
     }
     else {
         // Flash functions return 0 if successful.
-        if (state.r[0] != 0) {
+        if (r0 != 0) {
             return 0;
         }
     }
@@ -735,6 +1014,15 @@ uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t e
     return 1;
 }
 
+uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, flash_algo_return_t return_type)
+{
+    if (!swd_flash_syscall_start(sysCallParam, entry, arg1, arg2, arg3, arg4)) {
+        return 0;
+    }
+
+    return swd_flash_syscall_wait(return_type);
+}
+
 // SWD Reset
 static uint8_t swd_reset(void)
 {
@@ -799,14 +1087,84 @@ uint8_t JTAG2SWD()
     return 1;
 }
 
-uint8_t swd_init_debug(void)
+// Request DP power-up and wait for the acknowledge
+static uint8_t swd_power_up_dp(void)
 {
     uint32_t tmp = 0;
     int i = 0;
     int timeout = 100;
+
+    if (!swd_clear_errors()) {
+        return 0;
+    }
+
+    if (!swd_write_dp(DP_SELECT, 0)) {
+        return 0;
+    }
+
+    // Power up
+    if (!swd_write_dp(DP_CTRL_STAT, CSYSPWRUPREQ | CDBGPWRUPREQ)) {
+        return 0;
+    }
+
+    for (i = 0; i < timeout; i++) {
+        if (!swd_read_dp(DP_CTRL_STAT, &tmp)) {
+            return 0;
+        }
+        if ((tmp & (CDBGPWRUPACK | CSYSPWRUPACK)) == (CDBGPWRUPACK | CSYSPWRUPACK)) {
+            // Break from loop if powerup is complete
+            break;
+        }
+    }
+    if (i == timeout) {
+        // Unable to powerup DP
+        return 0;
+    }
+
+    return swd_write_dp(DP_CTRL_STAT, CSYSPWRUPREQ | CDBGPWRUPREQ | TRNNORMAL | MASKLANE);
+}
+
+// Check whether the DP brought up by swd_preattach() is still powered up and error free
+static uint8_t swd_preattach_reuse(void)
+{
+    uint32_t tmp;
+
+    if (!preattach.attached) {
+        return 0;
+    }
+    preattach.attached = 0;
+
+    // The pre-attach skipped the family hooks, let the full bring-up run them
+    if (g_target_family && (g_target_family->target_before_init_debug ||
+                            g_target_family->target_unlock_sequence)) {
+        return 0;
+    }
+
+    swd_init();
+    if (!swd_read_dp(DP_CTRL_STAT, &tmp)) {
+        return 0;
+    }
+    if ((tmp & (CDBGPWRUPACK | CSYSPWRUPACK)) != (CDBGPWRUPACK | CSYSPWRUPACK)) {
+        return 0;
+    }
+    if (tmp & (STICKYERR | STICKYCMP | STICKYORUN | WDATAERR)) {
+        return 0;
+    }
+    return swd_write_dp(DP_SELECT, 0);
+}
+
+uint8_t swd_init_debug(void)
+{
     // init dap state with fake values
     dap_state.select = 0xffffffff;
     dap_state.csw = 0xffffffff;
+    dap_state.tar = 0xffffffff;
+    // Target registers are unknown after a reset or reconnect
+    algo_session.valid = 0;
+
+    if (swd_preattach_reuse()) {
+        return 1;
+    }
 
     int8_t retries = 4;
     int8_t do_abort = 0;
@@ -833,40 +1191,7 @@ uint8_t swd_init_debug(void)
             continue;
         }
 
-        if (!swd_clear_errors()) {
-            do_abort = 1;
-            continue;
-        }
-
-        if (!swd_write_dp(DP_SELECT, 0)) {
-            do_abort = 1;
-            continue;
-
-        }
-
-        // Power up
-        if (!swd_write_dp(DP_CTRL_STAT, CSYSPWRUPREQ | CDBGPWRUPREQ)) {
-            do_abort = 1;
-            continue;
-        }
-
-        for (i = 0; i < timeout; i++) {
-            if (!swd_read_dp(DP_CTRL_STAT, &tmp)) {
-                do_abort = 1;
-                break;
-            }
-            if ((tmp & (CDBGPWRUPACK | CSYSPWRUPACK)) == (CDBGPWRUPACK | CSYSPWRUPACK)) {
-                // Break from loop if powerup is complete
-                break;
-            }
-        }
-        if ((i == timeout) || (do_abort == 1)) {
-            // Unable to powerup DP
-            do_abort = 1;
-            continue;
-        }
-
-        if (!swd_write_dp(DP_CTRL_STAT, CSYSPWRUPREQ | CDBGPWRUPREQ | TRNNORMAL | MASKLANE)) {
+        if (!swd_power_up_dp()) {
             do_abort = 1;
             continue;
         }
@@ -890,10 +1215,57 @@ uint8_t swd_init_debug(void)
     return 0;
 }
 
+uint8_t swd_preattach(void)
+{
+    uint32_t idcode;
+
+    preattach.attached = 0;
+    preattach.valid = 0;
+    // Such targets are only reachable while held in reset
+    if (reset_connect == CONNECT_UNDER_RESET) {
+        return 0;
+    }
+
+    // A single identification attempt that neither resets the target nor
+    // calls the family hooks
+    swd_init();
+    if (!JTAG2SWD() || !swd_read_dp(DP_IDCODE, &idcode)) {
+        swd_off();
+        return 0;
+    }
+    preattach.idcode = idcode;
+    preattach.valid = 1;
+
+#if SWD_PREATTACH_POWERUP
+    // Leave the DP powered up for the first swd_init_debug()
+    if (swd_power_up_dp()) {
+        preattach.attached = 1;
+    }
+#endif
+
+    // Release the pins in case the target uses them
+    swd_off();
+    return 1;
+}
+
+uint8_t swd_get_preattach_idcode(uint32_t *idcode)
+{
+    if (!preattach.valid) {
+        return 0;
+    }
+    *idcode = preattach.idcode;
+    return 1;
+}
+
 uint8_t swd_set_target_state_hw(target_state_t state)
 {
     uint32_t val;
     int8_t ap_retries = 2;
+
+    // Target registers are unknown after a reset or reconnect
+    algo_session.valid = 0;
+    dap_state.tar = 0xffffffff;
+
     /* Calling swd_init prior to entering RUN state causes operations to fail. */
     if (state != RUN) {
         swd_init();
@@ -1035,6 +1407,11 @@ uint8_t swd_set_target_state_sw(target_state_t state)
 {
     uint32_t val;
     int8_t ap_retries = 2;
+
+    // Target registers are unknown after a reset or reconnect
+    algo_session.valid = 0;
+    dap_state.tar = 0xffffffff;
+
     /* Calling swd_init prior to enterring RUN state causes operations to fail. */
     if (state != RUN) {
         swd_init();
@@ -46,9 +46,49 @@ typedef enum {
     FLASHALGO_RETURN_POINTER
 } flash_algo_return_t;
 
+// Number of flash algo functions whose run time is tracked
+#ifndef SWD_ALGO_TIMING_SLOTS
+#define SWD_ALGO_TIMING_SLOTS   8
+#endif
+
+// Time in microseconds to poll DHCSR back-to-back before backing off with
+// osDelay. Sleeping any earlier costs a whole OS tick on short functions
+// such as ProgramPage.
+#ifndef SWD_HALT_SPIN_US
+#define SWD_HALT_SPIN_US        10000
+#endif
+
+// Longest sleep between DHCSR polls in milliseconds
+#ifndef SWD_HALT_POLL_MAX_MS
+#define SWD_HALT_POLL_MAX_MS    2
+#endif
+
+// Set to 0 in the HIC yaml when gpio_set_board_power() switches the target
+// supply. The target is unpowered until USB is configured, too late for the
+// pre-attach.
+#ifndef SWD_PREATTACH
+#define SWD_PREATTACH           1
+#endif
+
+// Set to 0 in the board yaml to release the DP after the pre-attach instead
+// of leaving it powered up for the first swd_init_debug().
+#ifndef SWD_PREATTACH_POWERUP
+#define SWD_PREATTACH_POWERUP   1
+#endif
+
+// Give up on a flash algo function after this many milliseconds
+#ifndef SWD_HALT_TIMEOUT_MS
+#define SWD_HALT_TIMEOUT_MS     30000
+#endif
+
 uint8_t swd_init(void);
 uint8_t swd_off(void);
 uint8_t swd_init_debug(void);
+// Identify the target ahead of the first connection, without resetting it.
+// With SWD_PREATTACH_POWERUP the next swd_init_debug() reuses the powered up
+// DP if it is still intact and the target family has no init or unlock hooks.
+uint8_t swd_preattach(void);
+uint8_t swd_get_preattach_idcode(uint32_t *idcode);
 uint8_t swd_clear_errors(void);
 uint8_t swd_read_dp(uint8_t adr, uint32_t *val);
 uint8_t swd_write_dp(uint8_t adr, uint32_t val);
@@ -62,7 +102,15 @@ uint8_t swd_read_memory(uint32_t address, uint8_t *data, uint32_t size);
 uint8_t swd_write_memory(uint32_t address, uint8_t *data, uint32_t size);
 uint8_t swd_read_core_register(uint32_t n, uint32_t *val);
 uint8_t swd_write_core_register(uint32_t n, uint32_t val);
+void swd_set_algo_session(uint8_t active);
+// Forget the core registers known from earlier calls, the session stays open
+void swd_invalidate_algo_session(void);
 uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, flash_algo_return_t return_type);
+// Split form of swd_flash_syscall_exec(). The target runs the function after
+// swd_flash_syscall_start() returns, memory stays accessible meanwhile. Any
+// other core access must wait for swd_flash_syscall_wait().
+uint8_t swd_flash_syscall_start(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4);
+uint8_t swd_flash_syscall_wait(flash_algo_return_t return_type);
 uint8_t swd_set_target_state_hw(target_state_t state);
 uint8_t swd_set_target_state_sw(target_state_t state);
 uint8_t swd_transfer_retry(uint32_t req, uint32_t *data);
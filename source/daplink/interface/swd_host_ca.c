@@ -310,6 +310,59 @@ static uint8_t swd_write_block(uint32_t address, uint8_t *data, uint32_t size)
     return (ack == 0x01);
 }
 
+// Read 32-bit word aligned values from target memory using address auto-increment.
+// size is in bytes.
+static uint8_t swd_read_block(uint32_t address, uint8_t *data, uint32_t size)
+{
+    uint8_t tmp_in[4], req, ack;
+    uint32_t size_in_words;
+    uint32_t i;
+
+    if (size == 0) {
+        return 0;
+    }
+
+    size_in_words = size / 4;
+
+    // CSW register
+    if (!swd_write_ap(AP_CSW, CSW_VALUE | CSW_SIZE32)) {
+        return 0;
+    }
+
+    if (swd_ca_select_state(address) == 0) {
+        return 0;
+    }
+
+    // TAR write
+    req = SWD_REG_AP | SWD_REG_W | (1 << 2);
+    int2array(tmp_in, address, 4);
+
+    if (swd_transfer_retry(req, (uint32_t *)tmp_in) != 0x01) {
+        return 0;
+    }
+
+    // DRW read
+    req = SWD_REG_AP | SWD_REG_R | (3 << 2);
+
+    // initiate first read, data comes back in next read
+    if (swd_transfer_retry(req, NULL) != 0x01) {
+        return 0;
+    }
+
+    for (i = 0; i < (size_in_words - 1); i++) {
+        if (swd_transfer_retry(req, (uint32_t *)data) != 0x01) {
+            return 0;
+        }
+
+        data += 4;
+    }
+
+    // read last word
+    req = SWD_REG_DP | SWD_REG_R | SWD_REG_ADR(DP_RDBUFF);
+    ack = swd_transfer_retry(req, (uint32_t *)data);
+    return (ack == 0x01);
+}
+
 // Read target memory.
 static uint8_t swd_read_data(uint32_t addr, uint32_t *val)
 {
@@ -410,19 +463,28 @@ uint8_t swd_write_word(uint32_t addr, uint32_t val)
 // size is in bytes.
 uint8_t swd_read_memory(uint32_t address, uint8_t *data, uint32_t size)
 {
-    uint32_t read_size;
-    uint32_t* read_data;
+    uint32_t n;
 
-    read_size = (size / 4);
-    read_data = (uint32_t*)data;
-    /* Write bytes until end */
-    while ((read_size > 0)) {
-        if (!swd_read_data(address, read_data)) {
+    // Only complete words are read
+    while (size > 3) {
+        // Limit to auto increment page size
+        n = TARGET_AUTO_INCREMENT_PAGE_SIZE - (address & (TARGET_AUTO_INCREMENT_PAGE_SIZE - 1));
+        if (size < n) {
+            n = size & 0xFFFFFFFC; // Only count complete words remaining
+        }
+
+        if (!swd_read_block(address, data, n)) {
             return 0;
         }
-        address+=4;
-        read_data++;
-        read_size--;
+
+        address += n;
+        data += n;
+        size -= n;
+    }
+    /* Auto increment is end */
+    /* Return the CSW reg value to SIZE8 */
+    if (!swd_write_ap(AP_CSW, CSW_VALUE | CSW_SIZE8)) {
+        return 0;
     }
 
     return 1;
@@ -620,10 +682,33 @@ static uint8_t swd_wait_until_halted(void)
     return 0;
 }
 
-uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, flash_algo_return_t return_type)
+uint8_t swd_preattach(void)
+{
+    // Not supported on Cortex-A, every connection does the full bring-up
+    return 0;
+}
+
+uint8_t swd_get_preattach_idcode(uint32_t *idcode)
+{
+    return 0;
+}
+
+void swd_set_algo_session(uint8_t active)
+{
+    // Core registers are always written in full on Cortex-A
+}
+
+void swd_invalidate_algo_session(void)
+{
+}
+
+// arg1 + arg2 of the function started by swd_flash_syscall_start(), returned by verify functions
+static uint32_t algo_call_end;
+
+uint8_t swd_flash_syscall_start(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4)
 {
     DEBUG_STATE state = {{0}, 0};
-    // Call flash algorithm function on target and wait for result.
+    // Call flash algorithm function on target, swd_flash_syscall_wait() collects the result.
     state.r[0]     = arg1;                   // R0: Argument 1
     state.r[1]     = arg2;                   // R1: Argument 2
     state.r[2]     = arg3;                   // R2: Argument 3
@@ -638,6 +723,14 @@ uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t e
         return 0;
     }
 
+    algo_call_end = arg1 + arg2;
+    return 1;
+}
+
+uint8_t swd_flash_syscall_wait(flash_algo_return_t return_type)
+{
+    uint32_t r0;
+
     if (!swd_wait_until_halted()) {
         return 0;
     }
@@ -646,19 +739,19 @@ uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t e
         return 0;
     }
 
-    if (!swd_read_core_register(0, &state.r[0])) {
+    if (!swd_read_core_register(0, &r0)) {
         return 0;
     }
 
     if ( return_type == FLASHALGO_RETURN_POINTER ) {
         // Flash verify functions return pointer to byte following the buffer if successful.
-        if (state.r[0] != (arg1 + arg2)) {
+        if (r0 != algo_call_end) {
             return 0;
         }
     }
     else {
         // Flash functions return 0 if successful.
-        if (state.r[0] != 0) {
+        if (r0 != 0) {
             return 0;
         }
     }
@@ -666,6 +759,15 @@ uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t e
     return 1;
 }
 
+uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4, flash_algo_return_t return_type)
+{
+    if (!swd_flash_syscall_start(sysCallParam, entry, arg1, arg2, arg3, arg4)) {
+        return 0;
+    }
+
+    return swd_flash_syscall_wait(return_type);
+}
+
 // SWD Reset
 static uint8_t swd_reset(void)
 {
@@ -33,9 +33,24 @@
 #include "settings.h"
 #include "target_family.h"
 #include "target_board.h"
+#include "crc.h"
 
 #define DEFAULT_PROGRAM_PAGE_MIN_SIZE   (256u)
 
+// CRC the algo code on the target to decide whether the algo is still
+// resident in target RAM. Set to 0 in the board yaml to always download the
+// algo.
+#ifndef FLASH_ALGO_RESIDENCY_CHECK
+#define FLASH_ALGO_RESIDENCY_CHECK      1
+#endif
+
+// Most bytes gathered in target RAM behind the program buffer and programmed
+// with one algo call, further bounded by the sector size and the RAM region.
+// Set to 0 in the board yaml to program every block as it arrives.
+#ifndef FLASH_PROGRAM_STAGING_SIZE
+#define FLASH_PROGRAM_STAGING_SIZE      (0x10000u)
+#endif
+
 typedef enum {
     STATE_CLOSED,
     STATE_OPEN,
@@ -46,11 +61,13 @@ static error_t target_flash_init(void);
 static error_t target_flash_uninit(void);
 static error_t target_flash_program_page(uint32_t adr, const uint8_t *buf, uint32_t size);
 static error_t target_flash_erase_sector(uint32_t addr);
+static error_t target_flash_erase_sector_start(uint32_t addr);
 static error_t target_flash_erase_chip(void);
 static uint32_t target_flash_program_page_min_size(uint32_t addr);
 static uint32_t target_flash_erase_sector_size(uint32_t addr);
 static uint8_t target_flash_busy(void);
 static error_t target_flash_set(uint32_t addr);
+static error_t target_flash_flush(void);
 
 static const flash_intf_t flash_intf = {
     target_flash_init,
@@ -62,6 +79,7 @@ static const flash_intf_t flash_intf = {
     target_flash_erase_sector_size,
     target_flash_busy,
     target_flash_set,
+    target_flash_erase_sector_start,
 };
 
 static state_t state = STATE_CLOSED;
@@ -79,6 +97,79 @@ static region_info_t * default_region = NULL;
 //saved flash start from flash algo
 static uint32_t flash_start = 0;
 
+// Contiguous data waiting in the program buffer
+static uint32_t staged_addr = 0;
+static uint32_t staged_size = 0;
+// CRC of the staged data as received, checked in automation mode
+static uint32_t staged_crc = 0;
+// Size of the staging area for the current sector, 0 if not used
+static uint32_t staging_size = 0;
+// Where the loop stub was downloaded, 0 if it is not in target RAM
+static uint32_t stub_addr = 0;
+// EraseSector started by target_flash_erase_sector_start() and not waited for
+static bool erase_pending = false;
+
+// Placed behind the staging area when it holds more than the algo accepts
+// per call. Calls ProgramPage for each program_buffer_size chunk and stops
+// at the first error. Entered with r0 = address, r1 = size, r2 = buffer,
+// r3 = ProgramPage. The chunk size is written in the word following it.
+//
+//          push {r4-r7, lr}
+//          movs r4, r0
+//          movs r5, r1
+//          movs r6, r2
+//          mov  r7, r3
+//  loop:   ldr  r1, chunk
+//          cmp  r5, r1
+//          bhs  1f
+//          movs r1, r5
+//  1:      movs r0, r4
+//          movs r2, r6
+//          adds r4, r4, r1
+//          adds r6, r6, r1
+//          subs r5, r5, r1
+//          blx  r7
+//          cmp  r0, #0
+//          bne  done
+//          cmp  r5, #0
+//          bne  loop
+//  done:   pop  {r4-r7, pc}
+//  chunk:  .word program_buffer_size
+static const uint32_t program_loop_stub[] = {
+    0x0004b5f0, 0x0016000d, 0x4907461f, 0xd200428d, 0x00200029,
+    0x18640032, 0x1a6d1876, 0x280047b8, 0x2d00d101, 0xbdf0d1f1,
+};
+
+// Run from the program buffer to check the resident algo code, returning
+// through the algo breakpoint. Entered with r0 = address, r1 = size and
+// r2 = expected CRC-32, returns 0 if the CRC of the code matches.
+//
+//          push {r4, r5, lr}
+//          ldr  r5, poly
+//          movs r3, #0
+//          mvns r3, r3
+//  byte:   cmp  r1, #0
+//          beq  done
+//          ldrb r4, [r0]
+//          eors r3, r4
+//          movs r4, #8
+//  bit:    lsrs r3, r3, #1
+//          bcc  1f
+//          eors r3, r5
+//  1:      subs r4, r4, #1
+//          bne  bit
+//          adds r0, r0, #1
+//          subs r1, r1, #1
+//          b    byte
+//  done:   mvns r0, r3
+//          eors r0, r2
+//          pop  {r4, r5, pc}
+//  poly:   .word 0xedb88320
+static const uint32_t algo_crc_stub[] = {
+    0x4d09b530, 0x43db2300, 0xd00a2900, 0x40637804, 0x085b2408, 0x406bd300,
+    0xd1fa1e64, 0x1e491c40, 0x43d8e7f2, 0xbd304050, 0xedb88320,
+};
+
 static program_target_t * get_flash_algo(uint32_t addr)
 {
     region_info_t * flash_region = g_board_info.target_cfg->flash_regions;
@@ -103,9 +194,28 @@ static program_target_t * get_flash_algo(uint32_t addr)
     }
 }
 
+// Wait for a sector erase left running on the target
+static error_t target_flash_erase_wait(void)
+{
+    if (!erase_pending) {
+        return ERROR_SUCCESS;
+    }
+    erase_pending = false;
+    if (!swd_flash_syscall_wait(FLASHALGO_RETURN_BOOL)) {
+        return ERROR_ERASE_SECTOR;
+    }
+    return ERROR_SUCCESS;
+}
+
 static error_t flash_func_start(flash_func_t func)
 {
     program_target_t * flash = current_flash_algo;
+    // Every algo call goes through here, the core must be done erasing
+    error_t status = target_flash_erase_wait();
+
+    if (status != ERROR_SUCCESS) {
+        return status;
+    }
 
     if (last_flash_func != func)
     {
@@ -129,26 +239,133 @@ static error_t flash_func_start(flash_func_t func)
     return ERROR_SUCCESS;
 }
 
+// Size of the algo code, the RW data from static_base on is modified by the algo
+static uint32_t flash_algo_code_size(const program_target_t * flash)
+{
+    if ((flash->sys_call_s.static_base > flash->algo_start) &&
+        (flash->sys_call_s.static_base < flash->algo_start + flash->algo_size)) {
+        return ROUND_DOWN(flash->sys_call_s.static_base - flash->algo_start, sizeof(uint32_t));
+    }
+    return flash->algo_size;
+}
+
+static bool flash_algo_resident(const program_target_t * flash)
+{
+#if FLASH_ALGO_RESIDENCY_CHECK
+    uint32_t code_size = flash_algo_code_size(flash);
+    uint32_t bkpt_offset = ROUND_DOWN(flash->sys_call_s.breakpoint - flash->algo_start, sizeof(uint32_t));
+    uint32_t bkpt;
+
+    if ((code_size == 0) || (bkpt_offset >= code_size) ||
+        (flash->program_buffer_size < sizeof(algo_crc_stub))) {
+        return false;
+    }
+
+    // The stub returns through the breakpoint, it must be there before running it
+    if (!swd_read_word(flash->algo_start + bkpt_offset, &bkpt) ||
+        (bkpt != flash->algo_blob[bkpt_offset / sizeof(uint32_t)])) {
+        return false;
+    }
+
+    // The program buffer holds no data while the algo is being changed
+    if (!swd_write_memory(flash->program_buffer, (uint8_t *)algo_crc_stub, sizeof(algo_crc_stub))) {
+        return false;
+    }
+    return swd_flash_syscall_exec(&flash->sys_call_s,
+                                  flash->program_buffer | 1,
+                                  flash->algo_start,
+                                  code_size,
+                                  crc32(flash->algo_blob, code_size),
+                                  0,
+                                  FLASHALGO_RETURN_BOOL);
+#else
+    return false;
+#endif
+}
+
+// Download the flash algo, or only its RW data if the code is still resident
+static error_t flash_algo_download(const program_target_t * flash)
+{
+    uint32_t offset = 0;
+
+    if (flash_algo_resident(flash)) {
+        offset = flash_algo_code_size(flash);
+        if (offset == flash->algo_size) {
+            return ERROR_SUCCESS;
+        }
+    }
+
+    if (0 == swd_write_memory(flash->algo_start + offset, (uint8_t *)flash->algo_blob + offset, flash->algo_size - offset)) {
+        return ERROR_ALGO_DL;
+    }
+    return ERROR_SUCCESS;
+}
+
+static uint32_t target_flash_staging_size(const program_target_t * flash, uint32_t addr)
+{
+#if FLASH_PROGRAM_STAGING_SIZE
+    const region_info_t * ram_region = g_board_info.target_cfg->ram_regions;
+    uint32_t buffer = flash->program_buffer;
+    uint32_t size = 0;
+    uint32_t i;
+
+    // RAM behind the buffer is only free if the algo, its data and stack are below it
+    if ((buffer < flash->sys_call_s.stack_pointer) || (buffer < flash->algo_start + flash->algo_size)) {
+        return 0;
+    }
+
+    for (i = 0; i < MAX_REGIONS; i++) {
+        if ((buffer >= ram_region[i].start) && (buffer < ram_region[i].end)) {
+            size = ram_region[i].end - buffer;
+            break;
+        }
+    }
+
+    // Leave room for the loop stub and its chunk size
+    if (size < sizeof(program_loop_stub) + sizeof(uint32_t)) {
+        return 0;
+    }
+    size -= sizeof(program_loop_stub) + sizeof(uint32_t);
+    size = MIN(size, target_flash_erase_sector_size(addr));
+    size = MIN(size, FLASH_PROGRAM_STAGING_SIZE);
+    return ROUND_DOWN(size, flash->program_buffer_size);
+#else
+    return 0;
+#endif
+}
+
 static error_t target_flash_set(uint32_t addr)
 {
-    program_target_t * new_flash_algo = get_flash_algo(addr);
+    program_target_t * new_flash_algo;
+    // Program what was staged with the previous algo and flash start
+    error_t status = target_flash_flush();
+    if (status != ERROR_SUCCESS) {
+        return status;
+    }
+
+    new_flash_algo = get_flash_algo(addr);
     if (new_flash_algo == NULL) {
         return ERROR_ALGO_MISSING;
     }
     if(current_flash_algo != new_flash_algo){
         //run uninit to last func
-        error_t status = flash_func_start(FLASH_FUNC_NOP);
+        status = flash_func_start(FLASH_FUNC_NOP);
         if (status != ERROR_SUCCESS) {
             return status;
         }
+        // A new algo has a different static base and stack
+        swd_invalidate_algo_session();
         // Download flash programming algorithm to target
-        if (0 == swd_write_memory(new_flash_algo->algo_start, (uint8_t *)new_flash_algo->algo_blob, new_flash_algo->algo_size)) {
-            return ERROR_ALGO_DL;
+        status = flash_algo_download(new_flash_algo);
+        if (status != ERROR_SUCCESS) {
+            return status;
         }
 
         current_flash_algo = new_flash_algo;
+        stub_addr = 0;
 
     }
+    staging_size = target_flash_staging_size(new_flash_algo, addr);
     return ERROR_SUCCESS;
 }
 
@@ -158,10 +375,15 @@ static error_t target_flash_init()
         last_flash_func = FLASH_FUNC_NOP;
 
         current_flash_algo = NULL;
+        erase_pending = false;
+        staged_size = 0;
+        staging_size = 0;
+        stub_addr = 0;
 
         if (0 == target_set_state(RESET_PROGRAM)) {
             return ERROR_RESET;
         }
+        swd_set_algo_session(1);
 
         //get default region
         region_info_t * flash_region = g_board_info.target_cfg->flash_regions;
@@ -183,10 +405,15 @@ static error_t target_flash_init()
 static error_t target_flash_uninit(void)
 {
     if (g_board_info.target_cfg) {
-        error_t status = flash_func_start(FLASH_FUNC_NOP);
+        error_t status = target_flash_flush();
         if (status != ERROR_SUCCESS) {
             return status;
         }
+        status = flash_func_start(FLASH_FUNC_NOP);
+        if (status != ERROR_SUCCESS) {
+            return status;
+        }
+        swd_set_algo_session(0);
         if (config_get_auto_rst()) {
             // Resume the target if configured to do so
             target_set_state(RESET_RUN);
@@ -206,6 +433,168 @@ static error_t target_flash_uninit(void)
     }
 }
 
+static error_t target_flash_crc_memory(uint32_t addr, uint32_t size, uint32_t *crc)
+{
+    uint8_t rb_buf[64];
+    uint32_t read_size;
+
+    *crc = 0;
+    while (size > 0) {
+        read_size = MIN(size, sizeof(rb_buf));
+        if (!swd_read_memory(addr, rb_buf, read_size)) {
+            return ERROR_ALGO_DATA_SEQ;
+        }
+        *crc = crc32_continue(*crc, rb_buf, read_size);
+        addr += read_size;
+        size -= read_size;
+    }
+    return ERROR_SUCCESS;
+}
+
+// Check staged data that was just programmed against the CRC of what was received,
+// so a bad copy in target RAM is not compared with itself
+static error_t target_flash_verify_staged(program_target_t * flash, uint32_t addr, uint32_t size, uint32_t crc)
+{
+    uint32_t offset;
+    uint32_t verify_size;
+    uint32_t read_crc;
+    error_t status;
+
+    if (flash->verify != 0) {
+        flash_algo_return_t return_type;
+        status = flash_func_start(FLASH_FUNC_VERIFY);
+        if (status != ERROR_SUCCESS) {
+            return status;
+        }
+        if ((flash->algo_flags & kAlgoVerifyReturnsAddress) != 0) {
+            return_type = FLASHALGO_RETURN_POINTER;
+        } else {
+            return_type = FLASHALGO_RETURN_BOOL;
+        }
+        for (offset = 0; offset < size; offset += verify_size) {
+            verify_size = MIN(size - offset, flash->program_buffer_size);
+            if (!swd_flash_syscall_exec(&flash->sys_call_s,
+                                        flash->verify,
+                                        addr + offset,
+                                        verify_size,
+                                        flash->program_buffer + offset,
+                                        0,
+                                        return_type)) {
+                return ERROR_WRITE_VERIFY;
+            }
+        }
+        // The algo compared flash with the program buffer, check the buffer itself
+        status = target_flash_crc_memory(flash->program_buffer, size, &read_crc);
+    } else {
+        status = target_flash_crc_memory(addr, size, &read_crc);
+    }
+    if (status != ERROR_SUCCESS) {
+        return status;
+    }
+    if (read_crc != crc) {
+        return ERROR_WRITE_VERIFY;
+    }
+    return ERROR_SUCCESS;
+}
+
+// Program the data gathered in the program buffer with a single algo call
+static error_t target_flash_flush(void)
+{
+    program_target_t * flash = current_flash_algo;
+    uint32_t addr = staged_addr;
+    uint32_t size = staged_size;
+    uint8_t ok;
+    error_t status;
+
+    if (size == 0) {
+        return ERROR_SUCCESS;
+    }
+    staged_size = 0;
+
+    status = flash_func_start(FLASH_FUNC_PROGRAM);
+    if (status != ERROR_SUCCESS) {
+        return status;
+    }
+
+    if (size <= flash->program_buffer_size) {
+        ok = swd_flash_syscall_exec(&flash->sys_call_s,
+                                    flash->program_page,
+                                    addr,
+                                    size,
+                                    flash->program_buffer,
+                                    0,
+                                    FLASHALGO_RETURN_BOOL);
+    } else {
+        uint32_t stub = flash->program_buffer + staging_size;
+        if (stub_addr != stub) {
+            if (!swd_write_memory(stub, (uint8_t *)program_loop_stub, sizeof(program_loop_stub)) ||
+                !swd_write_word(stub + sizeof(program_loop_stub), flash->program_buffer_size)) {
+                return ERROR_ALGO_DATA_SEQ;
+            }
+            stub_addr = stub;
+        }
+        // Thumb entry like the algo functions
+        ok = swd_flash_syscall_exec(&flash->sys_call_s,
+                                    stub | 1,
+                                    addr,
+                                    size,
+                                    flash->program_buffer,
+                                    flash->program_page | 1,
+                                    FLASHALGO_RETURN_BOOL);
+    }
+    if (!ok) {
+        return ERROR_WRITE;
+    }
+
+    if (config_get_automation_allowed()) {
+        // Verify data flashed if in automation mode
+        return target_flash_verify_staged(flash, addr, size, staged_crc);
+    }
+    return ERROR_SUCCESS;
+}
+
+// Gather contiguous data in the program buffer, programming it once the
+// staging area is full or the data is not contiguous
+static error_t target_flash_stage(uint32_t addr, const uint8_t *buf, uint32_t size)
+{
+    program_target_t * flash = current_flash_algo;
+    uint32_t write_size;
+    error_t status;
+
+    while (size > 0) {
+        if ((staged_size != 0) && (addr != staged_addr + staged_size)) {
+            status = target_flash_flush();
+            if (status != ERROR_SUCCESS) {
+                return status;
+            }
+        }
+        if (staged_size == 0) {
+            staged_addr = addr;
+            staged_crc = 0;
+        }
+
+        write_size = MIN(size, staging_size - staged_size);
+        if (!swd_write_memory(flash->program_buffer + staged_size, (uint8_t *)buf, write_size)) {
+            return ERROR_ALGO_DATA_SEQ;
+        }
+        if (config_get_automation_allowed()) {
+            staged_crc = crc32_continue(staged_crc, buf, write_size);
+        }
+        staged_size += write_size;
+        addr += write_size;
+        buf += write_size;
+        size -= write_size;
+
+        if (staged_size == staging_size) {
+            status = target_flash_flush();
+            if (status != ERROR_SUCCESS) {
+                return status;
+            }
+        }
+    }
+    return ERROR_SUCCESS;
+}
+
 static error_t target_flash_program_page(uint32_t addr, const uint8_t *buf, uint32_t size)
 {
     if (g_board_info.target_cfg) {
@@ -223,6 +612,12 @@ static error_t target_flash_program_page(uint32_t addr, const uint8_t *buf, uint
             }
         }
 
+        // Staged data is written while an erase may still run, the
+        // algo is only called once it is programmed
+        if (staging_size != 0) {
+            return target_flash_stage(addr, buf, size);
+        }
+
         status = flash_func_start(FLASH_FUNC_PROGRAM);
 
         if (status != ERROR_SUCCESS) {
@@ -302,6 +697,16 @@ static error_t target_flash_program_page(uint32_t addr, const uint8_t *buf, uint
 }
 
 static error_t target_flash_erase_sector(uint32_t addr)
+{
+    error_t status = target_flash_erase_sector_start(addr);
+
+    if (status != ERROR_SUCCESS) {
+        return status;
+    }
+    return target_flash_erase_wait();
+}
+
+static error_t target_flash_erase_sector_start(uint32_t addr)
 {
     if (g_board_info.target_cfg) {
         error_t status = ERROR_SUCCESS;
@@ -316,15 +721,27 @@ static error_t target_flash_erase_sector(uint32_t addr)
             return ERROR_ERASE_SECTOR;
         }
 
+        // Without a staging area the first block of the sector waits for
+        // the erase anyway, so nothing overlaps it
+        if (staging_size == 0) {
+            return target_flash_erase_sector(addr);
+        }
+
+        status = target_flash_flush();
+        if (status != ERROR_SUCCESS) {
+            return status;
+        }
+
         status = flash_func_start(FLASH_FUNC_ERASE);
 
         if (status != ERROR_SUCCESS) {
             return status;
         }
 
-        if (0 == swd_flash_syscall_exec(&flash->sys_call_s, flash->erase_sector, addr, 0, 0, 0, FLASHALGO_RETURN_BOOL)) {
+        if (0 == swd_flash_syscall_start(&flash->sys_call_s, flash->erase_sector, addr, 0, 0, 0)) {
             return ERROR_ERASE_SECTOR;
         }
+        erase_pending = true;
 
         return ERROR_SUCCESS;
     } else {
@@ -338,6 +755,11 @@ static error_t target_flash_erase_chip(void)
         error_t status = ERROR_SUCCESS;
         region_info_t * flash_region = g_board_info.target_cfg->flash_regions;
 
+        status = target_flash_flush();
+        if (status != ERROR_SUCCESS) {
+            return status;
+        }
+
         for (; flash_region->start != 0 || flash_region->end != 0; ++flash_region) {
             program_target_t *new_flash_algo = get_flash_algo(flash_region->start);
             if ((new_flash_algo != NULL) && ((new_flash_algo->algo_flags & kAlgoSkipChipErase) != 0)) {
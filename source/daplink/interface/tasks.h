@@ -30,4 +30,16 @@
 #endif
 #define MAIN_TASK_PRIORITY  (osPriorityNormal)
 
+// Computes the region CRCs once USB is up
+#ifndef CRC_TASK_STACK
+#define CRC_TASK_STACK      (256)
+#endif
+#define CRC_TASK_PRIORITY   (osPriorityLow)
+
+// Brings up the target DP while USB waits to connect
+#ifndef PREATTACH_TASK_STACK
+#define PREATTACH_TASK_STACK    (512)
+#endif
+#define PREATTACH_TASK_PRIORITY (osPriorityBelowNormal)
+
 #endif
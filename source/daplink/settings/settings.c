@@ -60,10 +60,16 @@ typedef struct __attribute__((__packed__)) cfg_ram {
 
     //Add new entries from here
     uint8_t page_erase_enable;
+
+    // Startup profile, recorded again on every boot
+    uint8_t boot_phases;
+    uint32_t boot_time[kBootPhaseCount];
 } cfg_ram_t;
 
 // Ensure hexdump field is word aligned.
 COMPILER_ASSERT((offsetof(cfg_ram_t, hexdump) % sizeof(uint32_t)) == 0);
+// The structure must fit in the shared RAM region
+COMPILER_ASSERT(sizeof(cfg_ram_t) <= DAPLINK_RAM_SHARED_SIZE);
 
 // Configuration RAM
 #if defined(__CC_ARM)
@@ -75,6 +81,8 @@ static cfg_ram_t config_ram __attribute__((section("cfgram")));
 // Ram copy of RAM config
 static cfg_ram_t config_ram_copy;
 
+static uint32_t config_generation;
+
 void config_init()
 {
     uint32_t new_size;
@@ -107,9 +115,20 @@ void config_init()
     config_rom_init();
 }
 
+uint32_t config_get_generation(void)
+{
+    return config_generation;
+}
+
+void config_changed(void)
+{
+    config_generation++;
+}
+
 void config_ram_set_hold_in_bl(bool hold)
 {
     config_ram.hold_in_bl = hold;
+    config_changed();
 }
 
 void config_ram_set_assert(const char *file, uint16_t line)
@@ -237,6 +256,7 @@ uint8_t config_ram_get_hexdumps(uint32_t **hexdumps)
 void config_ram_set_disable_msd(bool disable_msd)
 {
     config_ram.disable_msd = disable_msd;
+    config_changed();
 }
 
 uint8_t config_ram_get_disable_msd(void)
@@ -247,9 +267,31 @@ uint8_t config_ram_get_disable_msd(void)
 void config_ram_set_page_erase(bool page_erase_enable)
 {
     config_ram.page_erase_enable = page_erase_enable;
+    config_changed();
 }
 
 bool config_ram_get_page_erase(void)
 {
     return config_ram.page_erase_enable;
 }
+
+void config_ram_set_boot_time(boot_phase_t phase, uint32_t time_us)
+{
+    if (phase >= kBootPhaseCount) {
+        return;
+    }
+    config_ram.boot_time[phase] = time_us;
+    config_ram.boot_phases = MAX(config_ram.boot_phases, phase + 1);
+    config_changed();
+}
+
+uint8_t config_ram_get_boot_times(uint32_t *times, uint8_t count)
+{
+    uint8_t i;
+
+    count = MIN(count, config_ram.boot_phases);
+    for (i = 0; i < count; i++) {
+        times[i] = config_ram.boot_time[i];
+    }
+    return count;
+}
@@ -30,6 +30,21 @@
 extern "C" {
 #endif
 
+//! @brief Interface startup phases timed by main_task.
+typedef enum {
+    kBootPhaseConfig,           //!< config_init()
+    kBootPhaseGpio,             //!< gpio_init() and LED defaults
+    kBootPhaseDap,              //!< DAP_Setup()
+    kBootPhaseBoard,            //!< prerun_board_config()
+    kBootPhaseFamily,           //!< init_family() and prerun_target_config()
+    kBootPhaseInfo,             //!< info_init()
+    kBootPhaseBootloaderUpdate, //!< bootloader_check_and_update()
+    kBootPhaseUsbInit,          //!< usbd_init() until usbd_connect(0)
+    kBootPhaseConnect,          //!< USB_CONNECT_DELAY until usbd_connect(1)
+    kBootPhaseConfigured,       //!< Host configured the device
+    kBootPhaseCount
+} boot_phase_t;
+
 typedef enum {
     ASSERT_SOURCE_NONE = 0,
     ASSERT_SOURCE_BL = 1,
@@ -38,6 +53,9 @@ typedef enum {
 
 void config_init(void);
 
+// Incremented whenever a setting changes, for caching anything derived from them
+uint32_t config_get_generation(void);
+
 // Get/set settings residing in flash
 void config_set_auto_rst(bool on);
 void config_set_automation_allowed(bool on);
@@ -61,9 +79,14 @@ void config_ram_set_disable_msd(bool disable_msd);
 uint8_t config_ram_get_disable_msd(void);
 void config_ram_set_page_erase(bool page_erase_enable);
 bool config_ram_get_page_erase(void);
+// Time in microseconds from the start of main_task to the end of each boot phase.
+// config_ram_get_boot_times() returns the number of phases recorded so far.
+void config_ram_set_boot_time(boot_phase_t phase, uint32_t time_us);
+uint8_t config_ram_get_boot_times(uint32_t *times, uint8_t count);
 
-// Private - should only be called from settings.c
+// Private - should only be called from settings.c and settings_rom.c
 void config_rom_init(void);
+void config_changed(void);
 
 #ifdef __cplusplus
 }
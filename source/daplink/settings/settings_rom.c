@@ -19,6 +19,7 @@
  * limitations under the License.
  */
 
+#include <stddef.h>
 #include <string.h>
 
 #include "settings.h"
@@ -26,11 +27,34 @@
 #include "compiler.h"
 #include "cortex_m.h"
 #include "flash_hal.h"
+#include "daplink_addr.h"
+#include "crc.h"
 
 // 'kvld' in hex - key valid
 #define CFG_KEY             0x6b766c64
+// 'kvdt' in hex - key delta
+#define CFG_DELTA_KEY       0x6b766474
 #define SECTOR_BUFFER_SIZE  16
 
+// Least number of records in a sector for the log to be worth it
+#define CFG_LOG_MIN_RECORDS 16
+
+// The first record of the config sector is a full cfg_setting_t, the only
+// record older bootloaders read. Where the HIC can program records much
+// smaller than a sector, every following record only holds the bytes that
+// changed, so a change normally costs a single program instead of an erase.
+// A delta ends with a CRC so one torn by a reset is skipped. When the sector
+// is full the settings are compacted into a new snapshot.
+#if defined(DAPLINK_CFG_RECORD_SIZE) && \
+    (DAPLINK_SECTOR_SIZE / DAPLINK_CFG_RECORD_SIZE >= CFG_LOG_MIN_RECORDS)
+#define CFG_LOG             1
+#define CFG_RECORD_SIZE     DAPLINK_CFG_RECORD_SIZE
+#else
+#define CFG_LOG             0
+#define CFG_RECORD_SIZE     SECTOR_BUFFER_SIZE
+#endif
+#define CFG_SECTOR_RECORDS  (DAPLINK_SECTOR_SIZE / CFG_RECORD_SIZE)
+
 // WARNING - THIS STRUCTURE RESIDES IN NON-VOLATILE STORAGE!
 // Be careful with changes:
 // -Only add new members to end end of this structure
@@ -50,16 +74,29 @@ typedef struct __attribute__((__packed__)) cfg_setting {
 
 } cfg_setting_t;
 
+// WARNING - THIS STRUCTURE RESIDES IN NON-VOLATILE STORAGE!
+typedef struct __attribute__((__packed__)) cfg_delta {
+    uint32_t key;               // CFG_DELTA_KEY
+    uint8_t offset;             // Offset of the first changed byte in cfg_setting_t
+    uint8_t size;               // Number of changed bytes
+    uint8_t data[SECTOR_BUFFER_SIZE - 10];
+    uint32_t crc;               // crc32() of the bytes before it
+} cfg_delta_t;
+
 // Make sure FORMAT in generate_config.py is updated if size changes
 COMPILER_ASSERT(sizeof(cfg_setting_t) == 10);
 
 // Sector buffer must be as big or bigger than settings
 COMPILER_ASSERT(sizeof(cfg_setting_t) < SECTOR_BUFFER_SIZE);
+COMPILER_ASSERT(sizeof(cfg_delta_t) == SECTOR_BUFFER_SIZE);
 // Sector buffer must be a multiple of 4 bytes at least.
 // ProgramPage for some interfaces, like the k20dx, require that
 // the data is a multiple of 4 bytes, otherwise programming will
 // fail.  Assert 8 byte alignement just to be safe.
 COMPILER_ASSERT(SECTOR_BUFFER_SIZE % 8 == 0);
+// Records must tile the config sector
+COMPILER_ASSERT(CFG_RECORD_SIZE >= SECTOR_BUFFER_SIZE);
+COMPILER_ASSERT(DAPLINK_SECTOR_SIZE % CFG_RECORD_SIZE == 0);
 
 // Configuration ROM
 #if defined(__CC_ARM)
@@ -69,6 +106,14 @@ static volatile cfg_setting_t config_rom __attribute__((section("cfgrom")));
 #endif
 // Ram copy of ROM config
 static cfg_setting_t config_rom_copy;
+// Settings as currently stored in the log
+static cfg_setting_t config_rom_stored;
+// State of the log
+static bool cfg_valid;
+static uint32_t cfg_next_record;
+
+// Buffer for data to flash
+static uint8_t write_buffer[CFG_RECORD_SIZE] __ALIGNED(4);
 
 // Configuration defaults in flash
 static const cfg_setting_t config_default = {
@@ -78,103 +123,193 @@ static const cfg_setting_t config_default = {
     .detect_incompatible_target = 0
 };
 
-// Check if the configuration in flash needs to be updated
-static bool config_needs_update()
+static uint32_t record_addr(uint32_t record)
 {
-    // Update if cfgrom cannot be read (needs to be programmed).
-    if (!flash_is_readable((uint32_t)&config_rom, sizeof(config_rom))) {
-        return true;
-    }
+    return (uint32_t)&config_rom + record * CFG_RECORD_SIZE;
+}
+
+// Read the start of a record. Returns false if the record was never programmed.
+static bool record_read(uint32_t addr, uint8_t *buf)
+{
+    uint32_t i;
 
-    // Update if the key is invalid
-    if (CFG_KEY != config_rom.key) {
-        return true;
+    // Erased pages may not be readable on some interfaces
+    if (!flash_is_readable(addr, SECTOR_BUFFER_SIZE)) {
+        return false;
+    }
+    memcpy(buf, (void *)addr, SECTOR_BUFFER_SIZE);
+    for (i = 0; i < SECTOR_BUFFER_SIZE; i++) {
+        if (buf[i] != 0xFF) {
+            return true;
+        }
     }
+    return false;
+}
+
+static void record_prepare(const void *data, uint32_t size)
+{
+    memset(write_buffer, 0xFF, sizeof(write_buffer));
+    memcpy(write_buffer, data, size);
+}
 
-    // Update if the config key is valid but
-    // has a smaller size.
-    if (config_rom.size < sizeof(config_rom)) {
-        return true;
+static bool record_program(uint32_t addr)
+{
+    return flash_program_page(addr, sizeof(write_buffer), write_buffer) == 0;
+}
+
+// Replay the log. Returns the number of records used, or 0 if the sector does
+// not start with a valid snapshot.
+static uint32_t log_load(cfg_setting_t *cfg, uint16_t *stored_size)
+{
+    union {
+        cfg_setting_t setting;
+        cfg_delta_t delta;
+        uint8_t buf[SECTOR_BUFFER_SIZE];
+    } rec;
+    uint32_t record = 1;
+
+    if (!record_read(record_addr(0), rec.buf) || (CFG_KEY != rec.setting.key)) {
+        return 0;
     }
+    memcpy(cfg, &config_default, sizeof(*cfg));
+    memcpy(cfg, &rec.setting, MIN(rec.setting.size, sizeof(*cfg)));
+    *stored_size = rec.setting.size;
+
+#if CFG_LOG
+    for (; record < CFG_SECTOR_RECORDS; record++) {
+        if (!record_read(record_addr(record), rec.buf)) {
+            break;
+        }
+        // Anything else is an interrupted write, skip over it
+        if ((CFG_DELTA_KEY == rec.delta.key) &&
+            (crc32(&rec.delta, offsetof(cfg_delta_t, crc)) == rec.delta.crc) &&
+            (rec.delta.size <= sizeof(rec.delta.data)) &&
+            (rec.delta.offset + rec.delta.size <= sizeof(*cfg))) {
+            memcpy((uint8_t *)cfg + rec.delta.offset, rec.delta.data, rec.delta.size);
+        }
+    }
+#endif
+    return record;
+}
 
-    // The config is valid and has the right
-    // size so it does not need to be updated
-    return false;
+// Erase the log and write the settings as its snapshot. The config area is
+// a single sector, so the snapshot is ready before the erase and programmed
+// right after it, leaving no other work where a reset loses the settings.
+static void compact_cfg(cfg_setting_t *new_cfg)
+{
+    cfg_valid = false;
+    record_prepare(new_cfg, sizeof(cfg_setting_t));
+    if (flash_erase_sector(record_addr(0)) != 0) {
+        return;
+    }
+    if (!record_program(record_addr(0))) {
+        return;
+    }
+    cfg_valid = true;
+    cfg_next_record = 1;
+    memcpy(&config_rom_stored, new_cfg, sizeof(config_rom_stored));
 }
 
-// Reprogram the new settings if flash writing is allowed
+// Append the bytes that differ from the stored settings
 static void program_cfg(cfg_setting_t *new_cfg)
 {
-    uint32_t status;
-    uint32_t addr;
+    uint32_t first;
 
-    addr = (uint32_t)&config_rom;
-    status = flash_erase_sector(addr);
-    if (status != 0) {
+    for (first = 0; first < sizeof(cfg_setting_t); first++) {
+        if (((uint8_t *)new_cfg)[first] != ((uint8_t *)&config_rom_stored)[first]) {
+            break;
+        }
+    }
+    if (cfg_valid && (first == sizeof(cfg_setting_t))) {
+        // Nothing changed
         return;
     }
 
-    // Buffer for data to flash
-    uint8_t write_buffer[SECTOR_BUFFER_SIZE] __ALIGNED(4);
+#if CFG_LOG
+    cfg_delta_t delta;
+    uint32_t last;
 
-    memset(write_buffer, 0xFF, sizeof(write_buffer));
-    memcpy(write_buffer, new_cfg, sizeof(cfg_setting_t));
-    status = flash_program_page(addr, sizeof(write_buffer), write_buffer);
-    if (status != 0) {
-        return;
+    for (last = sizeof(cfg_setting_t) - 1; last > first; last--) {
+        if (((uint8_t *)new_cfg)[last] != ((uint8_t *)&config_rom_stored)[last]) {
+            break;
+        }
+    }
+
+    // Older bootloaders ignore the deltas, keep what they act on in the snapshot
+    if (cfg_valid && (cfg_next_record < CFG_SECTOR_RECORDS) &&
+            (last - first + 1 <= sizeof(delta.data)) &&
+            (new_cfg->automation_allowed == config_rom_stored.automation_allowed) &&
+            (new_cfg->detect_incompatible_target == config_rom_stored.detect_incompatible_target)) {
+        delta.key = CFG_DELTA_KEY;
+        delta.offset = first;
+        delta.size = last - first + 1;
+        memset(delta.data, 0xFF, sizeof(delta.data));
+        memcpy(delta.data, (uint8_t *)new_cfg + first, delta.size);
+        delta.crc = crc32(&delta, offsetof(cfg_delta_t, crc));
+        record_prepare(&delta, sizeof(delta));
+        // A failed write still consumes the record
+        if (record_program(record_addr(cfg_next_record++))) {
+            memcpy((uint8_t *)&config_rom_stored + first, delta.data, delta.size);
+            return;
+        }
     }
+#endif
+
+    compact_cfg(new_cfg);
 }
 
 void config_rom_init()
 {
+    uint32_t records;
+    uint16_t stored_size = 0;
+
     Init(0, 0, 0);
 
     // Fill in the ram copy with the defaults
     memcpy(&config_rom_copy, &config_default, sizeof(config_rom_copy));
 
-    if (flash_is_readable((uint32_t)&config_rom, sizeof(config_rom))) {
-        // Read settings from flash if the key is valid
-        if (CFG_KEY == config_rom.key) {
-            uint32_t size = MIN(config_rom.size, sizeof(config_rom));
-            memcpy(&config_rom_copy, (void *)&config_rom, size);
-        }
-    }
+    records = log_load(&config_rom_copy, &stored_size);
+    cfg_valid = (records != 0);
+    cfg_next_record = records;
+    memcpy(&config_rom_stored, &config_rom_copy, sizeof(config_rom_stored));
 
     // Fill in special values
     config_rom_copy.key = CFG_KEY;
     config_rom_copy.size = sizeof(config_rom);
 
-    // Write settings back to flash if they are out of date
-    // Note - program_cfg only programs data in bootloader mode
-    if (config_needs_update()) {
+    // Write settings back to flash if they are missing or have a smaller size
+    if (!cfg_valid || (stored_size < sizeof(config_rom))) {
         // Program with defaults if none are set
-        program_cfg(&config_rom_copy);
+        compact_cfg(&config_rom_copy);
     }
 }
 
-
 void config_set_auto_rst(bool on)
 {
     config_rom_copy.auto_rst = on;
     program_cfg(&config_rom_copy);
+    config_changed();
 }
 
 void config_set_automation_allowed(bool on)
 {
     config_rom_copy.automation_allowed = on;
     program_cfg(&config_rom_copy);
+    config_changed();
 }
 
 void config_set_overflow_detect(bool on)
 {
     config_rom_copy.overflow_detect = on;
     program_cfg(&config_rom_copy);
+    config_changed();
 }
 
 void config_set_detect_incompatible_target(bool on)
 {
     config_rom_copy.detect_incompatible_target = on;
     program_cfg(&config_rom_copy);
+    config_changed();
 }
 
 bool config_get_auto_rst()
@@ -28,9 +28,36 @@
 #include "flash_intf.h"
 #endif
 #include "target_family.h"
+#ifdef RTT_CDC_BRIDGE
+#include "rtt_bridge.h"
+#endif
+#ifdef SWO_ITM_ROUTE_CDC
+#include "circ_buf.h"
+#include "swo_itm.h"
+#endif
 
 UART_Configuration UART_Config;
 
+#ifdef SWO_ITM_ROUTE_CDC
+// ITM stimulus port data routed from SWO capture, sent ahead of UART data
+static uint8_t swo_route_buffer[256];
+static circ_buf_t swo_route_circ_buf = {
+    .head = 0,
+    .tail = 0,
+    .size = sizeof(swo_route_buffer),
+    .buf = swo_route_buffer,
+};
+
+void swo_itm_route(uint8_t port, uint8_t data)
+{
+    (void)port;
+    // Drop data rather than stall SWO capture when the host is not reading
+    if (circ_buf_count_free(&swo_route_circ_buf)) {
+        circ_buf_push(&swo_route_circ_buf, data);
+    }
+}
+#endif
+
 /** @brief  Vitual COM Port initialization
  *
  *  The function inititalizes the hardware resources of the port used as
@@ -158,15 +185,34 @@ void cdc_process_event()
     int32_t len_data = 0;
     uint8_t data[64];
 
+#ifdef RTT_CDC_BRIDGE
+    // The target's RTT channel replaces the UART while the bridge is attached
+    if (rtt_bridge_process()) {
+        main_cdc_send_event();
+        return;
+    }
+#endif
+
     len_data = USBD_CDC_ACM_DataFree();
 
     if (len_data > sizeof(data)) {
         len_data = sizeof(data);
     }
 
+#ifdef SWO_ITM_ROUTE_CDC
+    if (len_data) {
+        int32_t len_swo = circ_buf_read(&swo_route_circ_buf, data, len_data);
+        if (len_swo) {
+            len_data = len_swo;
+        } else {
+            len_data = uart_read_data(data, len_data);
+        }
+    }
+#else
     if (len_data) {
         len_data = uart_read_data(data, len_data);
     }
+#endif
 
     if (len_data) {
         if (USBD_CDC_ACM_DataSend(data , len_data)) {
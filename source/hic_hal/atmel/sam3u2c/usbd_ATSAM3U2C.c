@@ -737,9 +737,7 @@ void USBD_Handler(void)
 
 #else
 
-                if (USBD_P_EP[n]) {
-                    USBD_P_EP[n](USBD_EVT_IN);
-                }
+                USBD_PostEvent(n, USBD_EVT_IN);
 
 #endif
             }
@@ -755,9 +753,7 @@ void USBD_Handler(void)
 
 #else
 
-                if (USBD_P_EP[n]) {
-                    USBD_P_EP[n](USBD_EVT_OUT);
-                }
+                USBD_PostEvent(n, USBD_EVT_OUT);
 
 #endif
             }
@@ -773,9 +769,7 @@ void USBD_Handler(void)
 
 #else
 
-                    if (USBD_P_EP[n]) {
-                        USBD_P_EP[n](USBD_EVT_IN_STALL);
-                    }
+                    USBD_PostEvent(n, USBD_EVT_IN_STALL);
 
 #endif
                 }
@@ -794,9 +788,7 @@ void USBD_Handler(void)
 
 #else
 
-                if (USBD_P_EP[n]) {
-                    USBD_P_EP[n](USBD_EVT_SETUP);
-                }
+                USBD_PostEvent(n, USBD_EVT_SETUP);
 
 #endif
             }
@@ -53,6 +53,7 @@
 
 #define DAPLINK_SECTOR_SIZE             0x00000400
 #define DAPLINK_MIN_WRITE_SIZE          0x00000100
+#define DAPLINK_CFG_RECORD_SIZE         0x00000010
 
 /* Current build */
 
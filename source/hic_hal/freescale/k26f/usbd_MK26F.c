@@ -642,6 +642,69 @@ uint32_t USBD_WriteEP(uint32_t EPNum, uint8_t *pData, uint32_t cnt)
 }
 
 
+/*
+ *  Get USB Device Endpoint Maximum Transfer
+ *    Parameters:      EPNum: Device Endpoint Number
+ *                       EPNum.0..3: Address
+ *                       EPNum.7:    Dir
+ *    Return Value:    Maximum bytes per USBD_WriteEPMulti transfer
+ */
+
+uint32_t USBD_MaxTransferEP(uint32_t EPNum)
+{
+    /* Five dTD buffer pointers, the first one may start anywhere in a page */
+    if ((EPNum & 0x80) && !(IsoEp & (1UL << ((EPNum & 0x7F) + 16)))) {
+        return 0x4000;
+    }
+
+    return 0;
+}
+
+
+/*
+ *  Write USB Device Endpoint Multi-Packet Transfer
+ *   The dTD points straight at pData, so no copy is made and the buffer
+ *   must stay unchanged until the IN event for the transfer
+ *    Parameters:      EPNum: Endpoint Number
+ *                       EPNum.0..3: Address
+ *                       EPNum.7:    Dir
+ *                     pData: Pointer to Data Buffer
+ *                     cnt:   Number of bytes to write
+ *    Return Value:    Number of bytes queued
+ */
+
+uint32_t USBD_WriteEPMulti(uint32_t EPNum, uint8_t *pData, uint32_t cnt)
+{
+    uint32_t idx, val, i;
+
+    EPNum &= 0x7F;
+    idx    = EP_IN_IDX(EPNum);
+    val    = (1UL << (EPNum + 16));
+
+    if (cnt > 0x4000) {
+        cnt = 0x4000;
+    }
+
+    dTDx[idx].buf[0]    = (uint32_t)pData;
+
+    for (i = 1; i < 5; i++) {
+        dTDx[idx].buf[i] = ((uint32_t)pData & ~0xFFF) + (i << 12);
+    }
+
+    dTDx[idx].next_dTD  = 1;
+    dTDx[idx].dTD_token = (cnt << 16) |           /* bytes to transfer */
+                          (1UL << 15) |           /* int on complete */
+                          0x80;                   /* status - active */
+    EPQHx[idx].next_dTD   = (uint32_t)(&dTDx[idx]);
+    EPQHx[idx].dTD_token &= ~0xC0;
+    USBHS->EPPRIME = (val);
+
+    while ((USBHS->EPPRIME & val));
+
+    return (cnt);
+}
+
+
 /*
  *  Get USB Device Last Frame Number
  *    Parameters:      None
@@ -787,9 +850,7 @@ void USBD_Handler(void)
 
 #else
 
-            if (USBD_P_EP[0]) {
-                USBD_P_EP[0](USBD_EVT_SETUP);
-            }
+            USBD_PostEvent(0, USBD_EVT_SETUP);
 
 #endif
         }
@@ -807,9 +868,7 @@ void USBD_Handler(void)
 
 #else
 
-                    if (USBD_P_EP[num]) {
-                        USBD_P_EP[num](USBD_EVT_IN);
-                    }
+                    USBD_PostEvent(num, USBD_EVT_IN);
 
 #endif
                 }
@@ -835,7 +894,7 @@ void USBD_Handler(void)
 #else
 
                     if (USBD_P_EP[num]) {
-                        USBD_P_EP[num](USBD_EVT_OUT);
+                        USBD_PostEvent(num, USBD_EVT_OUT);
 
                     } else if (IsoEp & (1UL << num)) {
                         if (USBD_P_SOF_Event) {
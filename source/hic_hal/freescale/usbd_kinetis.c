@@ -760,9 +760,7 @@ void USBD_Handler(void)
 
 #else
 
-                if (USBD_P_EP[num]) {
-                    USBD_P_EP[num](USBD_EVT_SETUP);
-                }
+                USBD_PostEvent(num, USBD_EVT_SETUP);
 
 #endif
 
@@ -780,9 +778,7 @@ void USBD_Handler(void)
 
 #else
 
-                    if (USBD_P_EP[num]) {
-                        USBD_P_EP[num](USBD_EVT_OUT);
-                    }
+                    USBD_PostEvent(num, USBD_EVT_OUT);
 
 #endif
                 }
@@ -797,9 +793,7 @@ void USBD_Handler(void)
 
 #else
 
-                    if (USBD_P_EP[num]) {
-                        USBD_P_EP[num](USBD_EVT_IN);
-                    }
+                    USBD_PostEvent(num, USBD_EVT_IN);
 
 #endif
                 }
@@ -568,7 +568,7 @@ void USBD_Handler(void)
 #ifdef __RTX
     if (USBD_RTX_EPTask[0]) { isr_evt_set(USBD_EVT_SETUP, USBD_RTX_EPTask[0]); }
 #else
-    if (USBD_P_EP[0]) { USBD_P_EP[0](USBD_EVT_SETUP); }
+    USBD_PostEvent(0, USBD_EVT_SETUP);
 #endif
   }
 
@@ -584,7 +584,7 @@ void USBD_Handler(void)
 #ifdef __RTX
         if (USBD_RTX_EPTask[ep]) { isr_evt_set(USBD_EVT_IN,  USBD_RTX_EPTask[ep]); }
 #else
-        if (USBD_P_EP[ep]) { USBD_P_EP[ep](USBD_EVT_IN); }
+        USBD_PostEvent(ep, USBD_EVT_IN);
 #endif
       }
 
@@ -604,7 +604,7 @@ void USBD_Handler(void)
 #ifdef __RTX
         if (USBD_RTX_EPTask[ep]) { isr_evt_set(USBD_EVT_OUT, USBD_RTX_EPTask[ep]); }
 #else
-        if (USBD_P_EP[ep]) { USBD_P_EP[ep](USBD_EVT_OUT); }
+        USBD_PostEvent(ep, USBD_EVT_OUT);
 #endif
       }
 
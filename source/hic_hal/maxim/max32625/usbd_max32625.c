@@ -583,9 +583,7 @@ void USBD_Handler(void)
             isr_evt_set(USBD_EVT_SETUP, USBD_RTX_EPTask[0]);
         }
 #else
-        if (USBD_P_EP[0]) {
-            USBD_P_EP[0](USBD_EVT_SETUP);
-        }
+        USBD_PostEvent(0, USBD_EVT_SETUP);
 #endif
     }
 
@@ -603,9 +601,7 @@ void USBD_Handler(void)
                     isr_evt_set(USBD_EVT_IN,  USBD_RTX_EPTask[ep]);
                 }
 #else
-                if (USBD_P_EP[ep]) {
-                    USBD_P_EP[ep](USBD_EVT_IN);
-                }
+                USBD_PostEvent(ep, USBD_EVT_IN);
 #endif
             }
 
@@ -627,9 +623,7 @@ void USBD_Handler(void)
                     isr_evt_set(USBD_EVT_OUT, USBD_RTX_EPTask[ep]);
                 }
 #else
-                if (USBD_P_EP[ep]) {
-                    USBD_P_EP[ep](USBD_EVT_OUT);
-                }
+                USBD_PostEvent(ep, USBD_EVT_OUT);
 #endif
             }
 
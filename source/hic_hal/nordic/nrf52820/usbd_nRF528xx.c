@@ -794,9 +794,7 @@ void USBD_IRQHandler (void) {
       isr_evt_set(USBD_EVT_SETUP, USBD_RTX_EPTask[0]);
     }
 #else
-    if (USBD_P_EP[0]) {
-      USBD_P_EP[0](USBD_EVT_SETUP);
-    }
+    USBD_PostEvent(0, USBD_EVT_SETUP);
 #endif
   }
 
@@ -815,9 +813,9 @@ void USBD_IRQHandler (void) {
 #else
     if (USBD_P_EP[0]) {
       if (ep0_dir != 0U) {
-        USBD_P_EP[0](USBD_EVT_IN);
+        USBD_PostEvent(0, USBD_EVT_IN);
       } else {
-        USBD_P_EP[0](USBD_EVT_OUT);
+        USBD_PostEvent(0, USBD_EVT_OUT);
       }
     }
 #endif
@@ -839,9 +837,7 @@ void USBD_IRQHandler (void) {
           isr_evt_set(USBD_EVT_IN, USBD_RTX_EPTask[ep_num]);
         }
 #else
-        if (USBD_P_EP[ep_num]) {
-          USBD_P_EP[ep_num](USBD_EVT_IN);
-        }
+        USBD_PostEvent(ep_num, USBD_EVT_IN);
 #endif
       }
     }
@@ -853,9 +849,7 @@ void USBD_IRQHandler (void) {
           isr_evt_set(USBD_EVT_OUT, USBD_RTX_EPTask[ep_num]);
         }
 #else
-        if (USBD_P_EP[ep_num]) {
-          USBD_P_EP[ep_num](USBD_EVT_OUT);
-        }
+        USBD_PostEvent(ep_num, USBD_EVT_OUT);
 #endif
       }
     }
@@ -55,6 +55,7 @@
 
 #define DAPLINK_SECTOR_SIZE             KB(4)
 #define DAPLINK_MIN_WRITE_SIZE          (256)
+#define DAPLINK_CFG_RECORD_SIZE         (16)
 
 /* Current build */
 
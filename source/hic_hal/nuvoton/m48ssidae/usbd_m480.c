@@ -700,9 +700,7 @@ void USBD_Handler_Main()
 
 #else
 
-            if (USBD_P_EP[0]) {
-                USBD_P_EP[0](USBD_EVT_SETUP);
-            }
+            USBD_PostEvent(0, USBD_EVT_SETUP);
 
 #endif
             HSUSBD_CLR_CEP_INT_FLAG(HSUSBD_CEPINTSTS_SETUPPKIF_Msk);
@@ -720,9 +718,7 @@ void USBD_Handler_Main()
 
 #else
 
-            if (USBD_P_EP[0]) {
-                USBD_P_EP[0](USBD_EVT_IN);
-            }
+            USBD_PostEvent(0, USBD_EVT_IN);
 
 #endif
             HSUSBD_CLR_CEP_INT_FLAG(HSUSBD_CEPINTSTS_TXPKIF_Msk);
@@ -738,9 +734,7 @@ void USBD_Handler_Main()
 
 #else
 
-            if (USBD_P_EP[0]) {
-                USBD_P_EP[0](USBD_EVT_OUT);
-            }
+            USBD_PostEvent(0, USBD_EVT_OUT);
 
 #endif
             HSUSBD_CLR_CEP_INT_FLAG(HSUSBD_CEPINTSTS_RXPKIF_Msk);
@@ -757,9 +751,7 @@ void USBD_Handler_Main()
 
 #else
 
-                if (USBD_P_EP[0]) {
-                    USBD_P_EP[0](USBD_EVT_OUT);
-                }
+                USBD_PostEvent(0, USBD_EVT_OUT);
 
 #endif
             } else {
@@ -771,9 +763,7 @@ void USBD_Handler_Main()
 
 #else
 
-                if (USBD_P_EP[0]) {
-                    USBD_P_EP[0](USBD_EVT_IN);
-                }
+                USBD_PostEvent(0, USBD_EVT_IN);
 
 #endif
             }
@@ -800,9 +790,7 @@ void USBD_Handler_Main()
 
 #else
 
-                if (USBD_P_EP[u32Num]) {
-                    USBD_P_EP[u32Num](USBD_EVT_IN);
-                }
+                USBD_PostEvent(u32Num, USBD_EVT_IN);
 
 #endif
             }
@@ -816,9 +804,7 @@ void USBD_Handler_Main()
 
 #else
 
-                if (USBD_P_EP[u32Num]) {
-                    USBD_P_EP[u32Num](USBD_EVT_OUT);
-                }
+                USBD_PostEvent(u32Num, USBD_EVT_OUT);
 
 #endif
             }
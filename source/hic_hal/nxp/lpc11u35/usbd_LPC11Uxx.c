@@ -786,9 +786,7 @@ void USBD_Handler(void)
 
 #else
 
-                    if (USBD_P_EP[num / 2]) {
-                        USBD_P_EP[num / 2](USBD_EVT_SETUP);
-                    }
+                    USBD_PostEvent(num / 2, USBD_EVT_SETUP);
 
 #endif
                 }
@@ -803,9 +801,7 @@ void USBD_Handler(void)
 
 #else
 
-                    if (USBD_P_EP[num / 2]) {
-                        USBD_P_EP[num / 2](USBD_EVT_OUT);
-                    }
+                    USBD_PostEvent(num / 2, USBD_EVT_OUT);
 
 #endif
                 }
@@ -820,9 +816,7 @@ void USBD_Handler(void)
 
 #else
 
-                    if (USBD_P_EP[num / 2]) {
-                        USBD_P_EP[num / 2](USBD_EVT_IN);
-                    }
+                    USBD_PostEvent(num / 2, USBD_EVT_IN);
 
 #endif
                 }
@@ -838,9 +838,7 @@ void USBD_Handler(void)
 
 #else
 
-                    if (USBD_P_EP[num / 2]) {
-                        USBD_P_EP[num / 2](USBD_EVT_SETUP);
-                    }
+                    USBD_PostEvent(num / 2, USBD_EVT_SETUP);
 
 #endif
                 }
@@ -855,9 +853,7 @@ void USBD_Handler(void)
 
 #else
 
-                    if (USBD_P_EP[num / 2]) {
-                        USBD_P_EP[num / 2](USBD_EVT_OUT);
-                    }
+                    USBD_PostEvent(num / 2, USBD_EVT_OUT);
 
 #endif
                 }
@@ -872,9 +868,7 @@ void USBD_Handler(void)
 
 #else
 
-                    if (USBD_P_EP[num / 2]) {
-                        USBD_P_EP[num / 2](USBD_EVT_IN);
-                    }
+                    USBD_PostEvent(num / 2, USBD_EVT_IN);
 
 #endif
                 }
@@ -744,9 +744,7 @@ void USBD_Handler(void)
 
 #else
 
-            if (USBD_P_EP[num]) {
-                USBD_P_EP[num](USBD_EVT_IN);
-            }
+            USBD_PostEvent(num, USBD_EVT_IN);
 
 #endif
         }
@@ -760,9 +758,7 @@ void USBD_Handler(void)
 
 #else
 
-            if (USBD_P_EP[num]) {
-                USBD_P_EP[num]((val & EP_SETUP) ? USBD_EVT_SETUP : USBD_EVT_OUT);
-            }
+            USBD_PostEvent(num, (val & EP_SETUP) ? USBD_EVT_SETUP : USBD_EVT_OUT);
 
 #endif
         }
@@ -21,6 +21,7 @@
 
 #include "cmsis_os2.h"
 #include "RTL.h"
+#include "RTX_Config.h"
 #include "cortex_m.h"
 
 #define MAIN_TASK_PRIORITY      (10)
@@ -134,6 +135,16 @@ osStatus_t osDelay(uint32_t ticks)
     return osOK;
 }
 
+uint32_t osKernelGetTickCount(void)
+{
+    return os_time_get();
+}
+
+uint32_t osKernelGetTickFreq(void)
+{
+    return 1000000 / os_clockrate;
+}
+
 uint32_t osKernelGetSysTimerCount(void)
 {
     return os_time_get();
@@ -174,7 +174,7 @@ BOOL USBD_MSC_CheckMedia(void)
 
 void USBD_MSC_MemoryRead(void)
 {
-    U32 n, m;
+    U32 n, m, max;
 
     if (Block >= USBD_MSC_BlockCount) {
         n = 0;
@@ -203,7 +203,28 @@ void USBD_MSC_MemoryRead(void)
         usbd_msc_read_sect(Block, USBD_MSC_BlockBuf, m);
     }
 
-    if (n) {
+    max = USBD_MaxTransferEP(usbd_msc_ep_bulkin | 0x80);
+
+    if (n && (max > n)) {
+        /* Queue the rest of the block group as one transfer, in whole packets */
+        m = USBD_MSC_BlockGroup * USBD_MSC_BlockSize - Offset;
+
+        if (m > Length) {
+            m = Length;
+        }
+
+        if (m > max) {
+            m = max;
+        }
+
+        if (m != Length) {
+            m -= m % usbd_msc_maxpacketsize[USBD_HighSpeed];
+        }
+
+        n = USBD_WriteEPMulti(usbd_msc_ep_bulkin | 0x80, &USBD_MSC_BlockBuf[Offset], m);
+        Offset += n;
+        Length -= n;
+    } else if (n) {
         USBD_WriteEP(usbd_msc_ep_bulkin | 0x80, &USBD_MSC_BlockBuf[Offset], n);
         Offset += n;
         Length -= n;
@@ -36,6 +36,9 @@ extern void  usbd_init(void);
 extern void  usbd_connect(BOOL con);
 extern void  usbd_reset_core(void);
 extern BOOL  usbd_configured(void);
+extern void  usbd_handler(void);
+extern void  usbd_signal(void);
+extern U32   usbd_event_timestamp(void);
 
 /* USB Device user functions imported to USB HID Class module                 */
 extern void  usbd_hid_init(void);
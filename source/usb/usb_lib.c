@@ -51,6 +51,12 @@ const U8 usbd_bos_enable = USBD_BOS_ENABLE;
 U16 usbd_if_num = USBD_IF_NUM_MAX;
 const U8 usbd_ep_num = USBD_EP_NUM;
 const U8 usbd_max_packet0 = USBD_MAX_PACKET0;
+/* Endpoints whose In/Out class handler tests USBD_EVT_IN before USBD_EVT_OUT */
+#if    (USBD_HID_ENABLE && (USBD_HID_EP_INTOUT != 0) && (USBD_HID_EP_INTIN == USBD_HID_EP_INTOUT))
+const U16 usbd_ep_in_first = (1 << USBD_HID_EP_INTIN);
+#else
+const U16 usbd_ep_in_first = 0;
+#endif
 
 
 /*------------------------------------------------------------------------------
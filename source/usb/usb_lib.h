@@ -33,6 +33,7 @@ extern const U8 usbd_bos_enable;
 extern const U16 usbd_if_num;
 extern const U8 usbd_ep_num;
 extern const U8 usbd_max_packet0;
+extern const U16 usbd_ep_in_first;
 
 
 /*------------------------------------------------------------------------------
@@ -37,6 +37,20 @@ U8 USBD_ZLP;
 USBD_EP_DATA USBD_EP0Data;
 USB_SETUP_PACKET USBD_SetupPacket;
 
+#if (USBD_EVENT_PROFILE)
+USBD_EP_STATS USBD_EPStats[16];
+#endif
+
+/* Endpoint events deferred until the end of the driver's interrupt pass */
+static U32 USBD_EPPending[16];      /* Pending events per endpoint */
+static U8 USBD_EPRepeat[16];        /* Earlier deliveries of the first pending direction */
+static U8 USBD_EPOrder[16];         /* Endpoints in order of their pending event */
+static U32 USBD_EPOrderCnt;
+#if (USBD_EVENT_PROFILE)
+static volatile U32 USBD_SignalTime;
+static volatile BOOL USBD_SignalArmed;
+#endif
+
 #ifdef __RTX
 OS_TID USBD_RTX_DevTask;            /* USB Device Task ID */
 OS_TID USBD_RTX_EPTask[16];         /* USB Endpoint Task ID's */
@@ -88,6 +102,10 @@ void usbd_reset_core(void)
     USBD_EndPointMask  = 0x00010001;
     USBD_EndPointHalt  = 0x00000000;
     USBD_EndPointStall = 0x00000000;
+    /* Events received before the bus reset are stale */
+    memset(USBD_EPPending, 0, sizeof(USBD_EPPending));
+    memset(USBD_EPRepeat, 0, sizeof(USBD_EPRepeat));
+    USBD_EPOrderCnt = 0;
 }
 
 
@@ -108,6 +126,236 @@ BOOL usbd_configured(void)
 }
 
 
+/*
+ *  USB Device Get Endpoint Maximum Transfer
+ *   Overridden by hardware drivers that can move several packets with one
+ *   USBD_WriteEPMulti call and a single completion event
+ *    Parameters:      EPNum: Device Endpoint Number
+ *                       EPNum.0..3: Address
+ *                       EPNum.7:    Dir
+ *    Return Value:    Maximum bytes per transfer, 0 if only single packets
+ *                     are supported
+ */
+
+__WEAK U32 USBD_MaxTransferEP(U32 EPNum)
+{
+    return 0;
+}
+
+
+/*
+ *  USB Device Write Endpoint Multi-Packet Transfer
+ *   The controller sends directly from pData, which must stay unchanged
+ *   until the USBD_EVT_IN event for the transfer. Only called when
+ *   USBD_MaxTransferEP returns non zero.
+ *    Parameters:      EPNum: Device Endpoint Number
+ *                       EPNum.0..3: Address
+ *                       EPNum.7:    Dir
+ *                     pData: Pointer to Data Buffer
+ *                     cnt:   Number of bytes to write
+ *    Return Value:    Number of bytes queued
+ */
+
+__WEAK U32 USBD_WriteEPMulti(U32 EPNum, U8 *pData, U32 cnt)
+{
+    return USBD_WriteEP(EPNum, pData, cnt);
+}
+
+
+/*
+ *  USB Device Event Timestamp
+ *   Free running tick counter used for the event latency histograms,
+ *   overridden by the application when USBD_EVENT_PROFILE is enabled
+ *    Parameters:      None
+ *    Return Value:    Tick count
+ */
+
+__WEAK U32 usbd_event_timestamp(void)
+{
+    return 0;
+}
+
+
+/*
+ *  USB Device Signal Function
+ *   Called from the USB interrupt when the USB Device needs servicing
+ *    Parameters:      None
+ *    Return Value:    None
+ */
+
+void usbd_signal(void)
+{
+#if (USBD_EVENT_PROFILE)
+    /* Latency is measured from the first interrupt of a pass */
+    if (!USBD_SignalArmed) {
+        USBD_SignalTime = usbd_event_timestamp();
+        USBD_SignalArmed = __TRUE;
+    }
+#endif
+}
+
+
+/*
+ *  USB Device Handler Function
+ *   Called by the User task to service the USB Device after usbd_signal
+ *    Parameters:      None
+ *    Return Value:    None
+ */
+
+void usbd_handler(void)
+{
+    USBD_Handler();
+    USBD_DispatchEvents();
+#if (USBD_EVENT_PROFILE)
+    USBD_SignalArmed = __FALSE;
+#endif
+}
+
+
+/*
+ *  USB Device Call Endpoint Event Handler
+ *    Parameters:      EPNum: Endpoint Number
+ *                     event: Endpoint events
+ *    Return Value:    None
+ */
+
+static void USBD_CallEP(U32 EPNum, U32 event)
+{
+#if (USBD_EVENT_PROFILE)
+    U32 ticks;
+    U32 bin;
+
+    ticks = USBD_SignalArmed ? usbd_event_timestamp() - USBD_SignalTime : 0;
+    for (bin = 0; (ticks != 0) && (bin < USBD_EVENT_LATENCY_BINS - 1); bin++) {
+        ticks >>= 1;
+    }
+    USBD_EPStats[EPNum].Calls++;
+    USBD_EPStats[EPNum].Latency[bin]++;
+#endif
+    USBD_P_EP[EPNum](event);
+}
+
+
+/*
+ *  USB Device Endpoint First Direction
+ *   Direction the class handler of an endpoint tests first
+ *    Parameters:      EPNum: Endpoint Number
+ *    Return Value:    USBD_EVT_IN or USBD_EVT_OUT
+ */
+
+static U32 USBD_EPFirst(U32 EPNum)
+{
+    return (usbd_ep_in_first & (1 << EPNum)) ? USBD_EVT_IN : USBD_EVT_OUT;
+}
+
+
+/*
+ *  USB Device Flush Endpoint Events
+ *   Call the class handler of one endpoint with its pending events
+ *    Parameters:      EPNum: Endpoint Number
+ *    Return Value:    None
+ */
+
+static void USBD_FlushEP(U32 EPNum)
+{
+    U32 event;
+    U32 repeat;
+    U32 i;
+
+    event = USBD_EPPending[EPNum];
+    if (event == 0) {
+        return;
+    }
+    repeat = USBD_EPRepeat[EPNum];
+    USBD_EPPending[EPNum] = 0;
+    USBD_EPRepeat[EPNum] = 0;
+
+    for (i = 0; i < USBD_EPOrderCnt; i++) {
+        if (USBD_EPOrder[i] == EPNum) {
+            USBD_EPOrderCnt--;
+            memmove(&USBD_EPOrder[i], &USBD_EPOrder[i + 1], USBD_EPOrderCnt - i);
+            break;
+        }
+    }
+
+    /* One call per packet, a merged second direction comes with the last */
+    if (repeat != 0) {
+        U32 first = (event == (USBD_EVT_OUT | USBD_EVT_IN)) ? USBD_EPFirst(EPNum) : event;
+
+        while (repeat--) {
+            USBD_CallEP(EPNum, first);
+        }
+    }
+    USBD_CallEP(EPNum, event);
+}
+
+
+/*
+ *  USB Device Post Endpoint Event
+ *   Called by the hardware driver instead of calling USBD_P_EP directly. The
+ *   event is handed to the class handler by USBD_DispatchEvents. Repeated
+ *   IN or OUT events of an endpoint are counted, and the other direction is
+ *   merged into the same call when the class handler tests it second, so
+ *   the handler sees the events in the order they arrived.
+ *    Parameters:      EPNum: Endpoint Number
+ *                     event: Endpoint event (USBD_EVT_*)
+ *    Return Value:    None
+ */
+
+void USBD_PostEvent(U32 EPNum, U32 event)
+{
+    U32 pending;
+
+    EPNum &= 0x0F;
+    if (USBD_P_EP[EPNum] == NULL) {
+        return;
+    }
+#if (USBD_EVENT_PROFILE)
+    USBD_EPStats[EPNum].Events++;
+#endif
+
+    /* Control transfers are handled right away to keep the stages in step */
+    if (EPNum == 0) {
+        USBD_CallEP(0, event);
+        return;
+    }
+
+    pending = USBD_EPPending[EPNum];
+    if (pending != 0) {
+        if ((event == USBD_EVT_OUT) || (event == USBD_EVT_IN)) {
+            if ((event == pending) && (USBD_EPRepeat[EPNum] < 0xFF)) {
+                USBD_EPRepeat[EPNum]++;
+                return;
+            }
+            if ((pending != event) && (pending == USBD_EPFirst(EPNum))) {
+                USBD_EPPending[EPNum] = pending | event;
+                return;
+            }
+        }
+        USBD_FlushEP(EPNum);
+    }
+
+    USBD_EPOrder[USBD_EPOrderCnt++] = EPNum;
+    USBD_EPPending[EPNum] = event;
+}
+
+
+/*
+ *  USB Device Dispatch Endpoint Events
+ *   Deliver all pending endpoint events in the order the endpoints were
+ *   signalled
+ *    Parameters:      None
+ *    Return Value:    None
+ */
+
+void USBD_DispatchEvents(void)
+{
+    while (USBD_EPOrderCnt != 0) {
+        USBD_FlushEP(USBD_EPOrder[0]);
+    }
+}
+
+
 /*
  *  USB Device Request - Setup Stage
  *    Parameters:      None
@@ -22,6 +22,15 @@
 #ifndef __USBD_CORE_H__
 #define __USBD_CORE_H__
 
+/* Collect per-endpoint event counts and dispatch latency histograms */
+#ifndef USBD_EVENT_PROFILE
+#define USBD_EVENT_PROFILE      0
+#endif
+
+/* Number of log2 latency histogram bins */
+#ifndef USBD_EVENT_LATENCY_BINS
+#define USBD_EVENT_LATENCY_BINS 16
+#endif
 
 /*--------------------------- Data structures --------------------------------*/
 
@@ -31,6 +40,14 @@ typedef struct _USBD_EP_DATA {
     U16 Count;
 } USBD_EP_DATA;
 
+/* USB Device Core Endpoint Event Statistics */
+typedef struct _USBD_EP_STATS {
+    U32 Events;                             /* Events posted by the driver     */
+    U32 Calls;                              /* Class handler invocations       */
+    U32 Latency[USBD_EVENT_LATENCY_BINS];   /* Signal to dispatch time, bin n  */
+                                            /* counts [2^(n-1), 2^n) ticks     */
+} USBD_EP_STATS;
+
 
 /*--------------------------- Global variables -------------------------------*/
 
@@ -48,6 +65,10 @@ extern U8 USBD_ZLP;
 extern USBD_EP_DATA USBD_EP0Data;
 extern USB_SETUP_PACKET USBD_SetupPacket;
 
+#if (USBD_EVENT_PROFILE)
+extern USBD_EP_STATS USBD_EPStats[16];
+#endif
+
 #ifdef __RTX
 extern OS_TID USBD_RTX_DevTask;
 extern OS_TID USBD_RTX_EPTask[];
@@ -67,6 +88,8 @@ extern void USBD_StatusOutStage(void);
 
 extern void usbd_class_init(void);
 extern void USBD_EndPoint0(U32 event);
+extern void USBD_PostEvent(U32 EPNum, U32 event);
+extern void USBD_DispatchEvents(void);
 
 #ifdef __RTX
 extern void USBD_RTX_EndPoint0(void);
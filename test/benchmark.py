@@ -0,0 +1,443 @@
+#
+# DAPLink Interface Firmware
+# Copyright (c) 2021, ARM Limited, All Rights Reserved
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+"""Measure DAPLink performance and compare it between firmware builds.
+
+Benchmarks, each producing one or more results:
+ - latency:  CMSIS-DAP command round trip over the bulk and HID endpoints
+ - transfer: target RAM read/write through DAP_TransferBlock per SWJ clock
+ - msc:      drag-n-drop programming of an image (needs --image)
+ - cdc:      sustained USB to UART throughput (needs the board's serial port)
+
+Results are written as JSON. Passing an earlier result file with --compare
+reports every result that got worse by more than --threshold percent and
+makes the script exit with an error.
+
+With --simulator no board is used. The CMSIS-DAP sources are built for the
+host with an SWD target simulated at the pin level (test/host/dap_sim.c) and
+the latency and transfer benchmarks run against it over a pty. Those results
+are named sim.* since they only compare builds of the DAP code with each other.
+
+Example:
+  python benchmark.py --output new.json --image blinky.hex --compare old.json
+  python benchmark.py --simulator --output sim.json
+"""
+
+from __future__ import absolute_import
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+import tty
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "host"))
+import run_host_tests
+
+DEFAULT_CLOCKS = [1000000, 4000000, 10000000]
+DEFAULT_LATENCY_COUNT = 1000
+DEFAULT_TRANSFER_SIZE = 16 * 1024
+DEFAULT_CDC_SIZE = 64 * 1024
+DEFAULT_CDC_BAUD = 115200
+DEFAULT_THRESHOLD = 10.0
+MSC_REMOUNT_TIMEOUT = 120
+
+# CMSIS-DAP commands and the simulated target used with --simulator
+ID_DAP_INFO = 0x00
+ID_DAP_CONNECT = 0x02
+ID_DAP_TRANSFER = 0x05
+ID_DAP_TRANSFER_BLOCK = 0x06
+ID_DAP_SWJ_CLOCK = 0x11
+ID_DAP_SWJ_SEQUENCE = 0x12
+DAP_INFO_PACKET_SIZE = 0xFF
+DAP_OK = 0x00
+DAP_TRANSFER_OK = 0x01
+REQ_AP = 0x01
+REQ_READ = 0x02
+DP_IDCODE = 0x00
+DP_CTRL_STAT = 0x04
+DP_SELECT = 0x08
+AP_CSW = 0x00
+AP_TAR = 0x04
+AP_DRW = 0x0C
+CSW_WORD_INCREMENT = 0x23000012
+POWER_UP_REQUEST = 0x50000000
+SIM_RAM_START = 0x20000000
+SIM_RAM_SIZE = 0x10000
+# TAR auto increment wraps at 1KB
+TAR_BLOCK = 1024
+
+# Whether a larger value is better, per unit
+HIGHER_IS_BETTER = {
+    "us": False,
+    "s": False,
+    "KB/s": True,
+    "MB/s": True,
+}
+
+
+def _percentile(samples, percent):
+    ordered = sorted(samples)
+    index = int(round((len(ordered) - 1) * percent / 100.0))
+    return ordered[index]
+
+
+def _interface_version(mount_point):
+    """Return the interface version from DETAILS.TXT, or None"""
+    try:
+        with open(os.path.join(mount_point, "DETAILS.TXT")) as details:
+            for line in details:
+                key, _, value = line.partition(":")
+                if key.strip() == "Interface Version":
+                    return value.strip()
+    except (IOError, OSError):
+        pass
+    return None
+
+
+class Results(object):
+
+    def __init__(self, unique_id, interface_version):
+        self.unique_id = unique_id
+        self.interface_version = interface_version
+        self.values = {}
+
+    def add(self, name, value, unit):
+        print("  %-40s %12.3f %s" % (name, value, unit))
+        self.values[name] = {"value": value, "unit": unit}
+
+    def to_dict(self):
+        return {
+            "unique_id": self.unique_id,
+            "interface_version": self.interface_version,
+            "timestamp": time.strftime("%Y-%m-%dT%H:%M:%S"),
+            "results": self.values,
+        }
+
+
+def _open_session(board, frequency=None, prefer_hid=False):
+    from pyocd.core.helpers import ConnectHelper
+    options = {"cmsis_dap.prefer_v1": prefer_hid}
+    if frequency is not None:
+        options["frequency"] = frequency
+    return ConnectHelper.session_with_chosen_probe(unique_id=board["target_id"],
+                                                   options=options)
+
+
+def bench_latency(board, results, count):
+    for transport, prefer_hid in (("bulk", False), ("hid", True)):
+        with _open_session(board, prefer_hid=prefer_hid) as session:
+            probe = session.probe
+            # A probe without the bulk endpoint falls back to HID
+            link = getattr(probe, "_link", None)
+            interface = getattr(link, "_interface", None)
+            if transport == "bulk" and not getattr(interface, "is_bulk", False):
+                print("  bulk endpoint not available (%s)" % type(interface).__name__)
+                continue
+            samples = []
+            for _ in range(count):
+                start = time.perf_counter()
+                probe.read_dp(0x0)          # DP IDCODE, one DAP_Transfer
+                samples.append((time.perf_counter() - start) * 1e6)
+            results.add("latency.%s.p50" % transport, _percentile(samples, 50), "us")
+            results.add("latency.%s.p99" % transport, _percentile(samples, 99), "us")
+
+
+def bench_transfer(board, results, clocks, size):
+    from pyocd.core.memory_map import MemoryType
+    for clock in clocks:
+        with _open_session(board, frequency=clock) as session:
+            target = session.target
+            ram = target.memory_map.get_default_region_of_type(MemoryType.RAM)
+            length = min(size, ram.length // 2) // 4
+            data = [(i * 0x01010101) & 0xFFFFFFFF for i in range(length)]
+
+            target.halt()
+            start = time.perf_counter()
+            target.write_memory_block32(ram.start, data)
+            target.flush()
+            write_time = time.perf_counter() - start
+
+            start = time.perf_counter()
+            readback = target.read_memory_block32(ram.start, length)
+            read_time = time.perf_counter() - start
+            target.reset()
+
+            if readback != data:
+                raise Exception("RAM readback mismatch at %i Hz" % clock)
+            name = "transfer.%ikhz" % (clock // 1000)
+            results.add(name + ".write", length * 4 / write_time / 1e6, "MB/s")
+            results.add(name + ".read", length * 4 / read_time / 1e6, "MB/s")
+
+
+def _wait_for_remount(board, timeout):
+    mount_point = board["mount_point"]
+    start = time.time()
+    # The drive goes away when the transfer is done, then comes back
+    while os.path.exists(mount_point):
+        if time.time() - start > timeout:
+            raise Exception("Drive did not unmount")
+        time.sleep(0.05)
+    while not os.path.exists(os.path.join(mount_point, "DETAILS.TXT")):
+        if time.time() - start > timeout:
+            raise Exception("Drive did not remount")
+        time.sleep(0.05)
+    return time.time() - start
+
+
+def bench_msc(board, results, image):
+    size = os.path.getsize(image)
+    destination = os.path.join(board["mount_point"], os.path.basename(image))
+    start = time.time()
+    shutil.copyfile(image, destination)
+    copy_time = time.time() - start
+    total_time = copy_time + _wait_for_remount(board, MSC_REMOUNT_TIMEOUT)
+
+    if os.path.exists(os.path.join(board["mount_point"], "FAIL.TXT")):
+        raise Exception("Programming %s failed" % image)
+    results.add("msc.program", size / total_time / 1024, "KB/s")
+    results.add("msc.program_time", total_time, "s")
+
+
+def bench_cdc(board, results, baud, size):
+    import serial
+    port = serial.Serial(board["serial_port"], baudrate=baud, timeout=1)
+    try:
+        block = bytes(bytearray(range(256))) * 4
+        written = 0
+        start = time.perf_counter()
+        while written < size:
+            written += port.write(block)
+        port.flush()
+        elapsed = time.perf_counter() - start
+    finally:
+        port.close()
+    results.add("cdc.%ibaud.write" % baud, written / elapsed / 1024, "KB/s")
+
+
+class SimulatorProbe(object):
+    """CMSIS-DAP firmware built for the host, see test/host/dap_sim.c"""
+
+    def __init__(self, cc):
+        self._build_dir = tempfile.TemporaryDirectory()
+        exe = os.path.join(self._build_dir.name, "dap_sim")
+        if not run_host_tests.build_dap_sim(cc, exe):
+            raise Exception("Building the simulator failed")
+        self._process = subprocess.Popen([exe], stdout=subprocess.PIPE)
+        pty_name = self._process.stdout.readline().decode().strip()
+        self._fd = os.open(pty_name, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self._fd)
+        info = self.command([ID_DAP_INFO, DAP_INFO_PACKET_SIZE])
+        self.packet_size = struct.unpack("<H", info[2:4])[0]
+
+    def close(self):
+        os.close(self._fd)
+        self._process.kill()
+        self._process.wait()
+        self._build_dir.cleanup()
+
+    def _read(self, size):
+        data = b""
+        while len(data) < size:
+            data += os.read(self._fd, size - len(data))
+        return data
+
+    def command(self, data):
+        data = bytes(bytearray(data))
+        os.write(self._fd, struct.pack("<H", len(data)) + data)
+        size = struct.unpack("<H", self._read(2))[0]
+        return self._read(size)
+
+    def transfer(self, requests):
+        """Run (request, value) pairs, value is None for reads. Return the values read."""
+        packet = [ID_DAP_TRANSFER, 0, len(requests)]
+        for request, value in requests:
+            packet.append(request)
+            if value is not None:
+                packet += struct.pack("<I", value)
+        response = self.command(packet)
+        if response[1] != len(requests) or response[2] != DAP_TRANSFER_OK:
+            raise Exception("DAP_Transfer failed: %s" % response.hex())
+        return list(struct.unpack("<%iI" % ((len(response) - 3) // 4), response[3:]))
+
+    def transfer_block(self, request, count, data=None):
+        packet = [ID_DAP_TRANSFER_BLOCK, 0] + list(struct.pack("<H", count)) + [request]
+        if data is not None:
+            packet += struct.pack("<%iI" % count, *data)
+        response = self.command(packet)
+        if struct.unpack("<H", response[1:3])[0] != count or response[3] != DAP_TRANSFER_OK:
+            raise Exception("DAP_TransferBlock failed: %s" % response.hex())
+        return list(struct.unpack("<%iI" % ((len(response) - 4) // 4), response[4:]))
+
+    def connect(self, clock):
+        self.command([ID_DAP_CONNECT, 1])
+        self.command([ID_DAP_SWJ_CLOCK] + list(struct.pack("<I", clock)))
+        # Line reset, JTAG to SWD, line reset and idle
+        for bits, data in ((56, [0xFF] * 7), (16, [0x9E, 0xE7]), (56, [0xFF] * 7), (8, [0x00])):
+            if self.command([ID_DAP_SWJ_SEQUENCE, bits] + data)[1] != DAP_OK:
+                raise Exception("DAP_SWJ_Sequence failed")
+        self.transfer([(REQ_READ | DP_IDCODE, None),
+                       (DP_CTRL_STAT, POWER_UP_REQUEST),
+                       (DP_SELECT, 0),
+                       (REQ_AP | AP_CSW, CSW_WORD_INCREMENT)])
+
+
+def bench_sim_latency(probe, results, count):
+    probe.connect(DEFAULT_CLOCKS[0])
+    samples = []
+    for _ in range(count):
+        start = time.perf_counter()
+        probe.transfer([(REQ_READ | DP_IDCODE, None)])
+        samples.append((time.perf_counter() - start) * 1e6)
+    results.add("sim.latency.p50", _percentile(samples, 50), "us")
+    results.add("sim.latency.p99", _percentile(samples, 99), "us")
+
+
+def bench_sim_transfer(probe, results, clocks, size):
+    length = min(size, SIM_RAM_SIZE) // 4
+    data = [(i * 0x01010101) & 0xFFFFFFFF for i in range(length)]
+    write_max = (probe.packet_size - 5) // 4
+    read_max = (probe.packet_size - 4) // 4
+
+    for clock in clocks:
+        probe.connect(clock)
+
+        start = time.perf_counter()
+        for offset in range(0, length, TAR_BLOCK // 4):
+            block = data[offset:offset + TAR_BLOCK // 4]
+            probe.transfer([(REQ_AP | AP_TAR, SIM_RAM_START + offset * 4)])
+            for index in range(0, len(block), write_max):
+                chunk = block[index:index + write_max]
+                probe.transfer_block(REQ_AP | AP_DRW, len(chunk), chunk)
+        write_time = time.perf_counter() - start
+
+        readback = []
+        start = time.perf_counter()
+        for offset in range(0, length, TAR_BLOCK // 4):
+            count = min(TAR_BLOCK // 4, length - offset)
+            probe.transfer([(REQ_AP | AP_TAR, SIM_RAM_START + offset * 4)])
+            for index in range(0, count, read_max):
+                readback += probe.transfer_block(REQ_AP | REQ_READ | AP_DRW,
+                                                 min(read_max, count - index))
+        read_time = time.perf_counter() - start
+
+        if readback != data:
+            raise Exception("Simulator RAM readback mismatch at %i Hz" % clock)
+        name = "sim.transfer.%ikhz" % (clock // 1000)
+        results.add(name + ".write", length * 4 / write_time / 1e6, "MB/s")
+        results.add(name + ".read", length * 4 / read_time / 1e6, "MB/s")
+
+
+def compare(current, baseline, threshold):
+    """Print results that regressed by more than threshold percent, return their count"""
+    regressions = 0
+    for name, result in sorted(current["results"].items()):
+        if name not in baseline["results"]:
+            continue
+        old = baseline["results"][name]["value"]
+        new = result["value"]
+        if old == 0:
+            continue
+        change = (new - old) * 100.0 / old
+        if not HIGHER_IS_BETTER.get(result["unit"], True):
+            change = -change
+        status = "ok"
+        if change < -threshold:
+            status = "REGRESSION"
+            regressions += 1
+        print("  %-40s %12.3f -> %12.3f %-5s %+7.1f%% %s" %
+              (name, old, new, result["unit"], change, status))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="DAPLink benchmark suite")
+    parser.add_argument("--board", help="Unique ID of the board to use, default is the first one found")
+    parser.add_argument("--output", default="benchmark.json", help="Result file to write")
+    parser.add_argument("--compare", help="Result file of an earlier run to compare against")
+    parser.add_argument("--threshold", type=float, default=DEFAULT_THRESHOLD,
+                        help="Allowed regression in percent, default %(default)s")
+    parser.add_argument("--skip", action="append", default=[],
+                        choices=["latency", "transfer", "msc", "cdc"], help="Benchmark to skip")
+    parser.add_argument("--latency-count", type=int, default=DEFAULT_LATENCY_COUNT,
+                        help="Round trips per latency measurement")
+    parser.add_argument("--clock", type=int, action="append",
+                        help="SWJ clock in Hz for the transfer benchmark, may be repeated")
+    parser.add_argument("--transfer-size", type=int, default=DEFAULT_TRANSFER_SIZE,
+                        help="Bytes of target RAM to write and read")
+    parser.add_argument("--image", help="Image to program for the MSC benchmark")
+    parser.add_argument("--cdc-baud", type=int, default=DEFAULT_CDC_BAUD, help="UART baud rate")
+    parser.add_argument("--cdc-size", type=int, default=DEFAULT_CDC_SIZE, help="Bytes to send over CDC")
+    parser.add_argument("--simulator", action="store_true",
+                        help="Run the latency and transfer benchmarks on the host-built CMSIS-DAP simulator")
+    parser.add_argument("--cc", default=os.environ.get("CC", "gcc"), help="Host C compiler for --simulator")
+    args = parser.parse_args()
+
+    if args.simulator:
+        results = Results("simulator", None)
+        print("Benchmarking the CMSIS-DAP simulator")
+        probe = SimulatorProbe(args.cc)
+        try:
+            if "latency" not in args.skip:
+                bench_sim_latency(probe, results, args.latency_count)
+            if "transfer" not in args.skip:
+                bench_sim_transfer(probe, results, args.clock or DEFAULT_CLOCKS, args.transfer_size)
+        finally:
+            probe.close()
+    else:
+        import mbed_lstools
+        boards = mbed_lstools.create().list_mbeds()
+        if args.board is not None:
+            boards = [b for b in boards if b["target_id"] == args.board]
+        if not boards:
+            print("No board found")
+            return 1
+        board = boards[0]
+        print("Benchmarking %s on %s" % (board["target_id"], board["mount_point"]))
+
+        results = Results(board["target_id"], _interface_version(board["mount_point"]))
+        if "latency" not in args.skip:
+            bench_latency(board, results, args.latency_count)
+        if "transfer" not in args.skip:
+            bench_transfer(board, results, args.clock or DEFAULT_CLOCKS, args.transfer_size)
+        if "msc" not in args.skip and args.image is not None:
+            bench_msc(board, results, args.image)
+        if "cdc" not in args.skip and board.get("serial_port"):
+            bench_cdc(board, results, args.cdc_baud, args.cdc_size)
+
+    current = results.to_dict()
+    with open(args.output, "w") as output:
+        json.dump(current, output, indent=4, sort_keys=True)
+
+    if args.compare is not None:
+        with open(args.compare) as baseline_file:
+            baseline = json.load(baseline_file)
+        print("Compared to %s (%s)" % (args.compare, baseline.get("interface_version")))
+        if compare(current, baseline, args.threshold):
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
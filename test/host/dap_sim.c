@@ -0,0 +1,382 @@
+/**
+ * @file    dap_sim.c
+ * @brief   CMSIS-DAP firmware on the host, serving commands over a pty
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2021, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// DAP.c and SW_DP.c run unchanged against an SWD target simulated at the pin
+// level: a DP, one MEM-AP and 64KB of RAM at 0x20000000. The pty name is
+// printed on stdout, then each packet is a little endian 16-bit length
+// followed by the command, answered the same way. Used by the benchmark
+// script when no board is connected.
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "DAP_config.h"
+#include "DAP.h"
+#include "target_board.h"
+
+#define DP_IDCODE_VALUE 0x2BA01477
+#define AP_IDR_VALUE    0x24770011
+#define RAM_START       0x20000000
+#define RAM_SIZE        0x10000
+
+// A[3:2] of a request as a register offset
+#define REQUEST_ADDR    (DAP_TRANSFER_A2 | DAP_TRANSFER_A3)
+
+// MEM-AP registers by bank and A[3:2]
+#define AP_CSW          0x00
+#define AP_TAR          0x04
+#define AP_DRW          0x0C
+#define AP_IDR          0xFC
+
+// Consecutive ones that reset the line
+#define LINE_RESET_BITS 50
+
+// Cycles after the request header. The simulator assumes the default
+// turnaround of one cycle.
+#define CYCLE_ACK       1
+#define CYCLE_RDATA     4
+#define CYCLE_RPARITY   36
+#define CYCLE_WDATA     5
+#define CYCLE_WPARITY   37
+#define CYCLE_END       38
+
+const board_info_t g_board_info;
+
+static struct {
+    uint32_t swclk;
+    uint32_t swdio;         // Level driven by the probe
+    uint32_t driving;
+    uint32_t ones;
+    uint8_t header;         // Last 8 bits from the probe
+    uint32_t busy;          // In a transfer after the header
+    uint32_t cycle;
+    uint32_t request;       // APnDP, RnW, A[3:2] as in DAP_TRANSFER_*
+    uint32_t rdata;
+    uint32_t wdata;
+    uint32_t ctrl_stat;
+    uint32_t select;
+    uint32_t rdbuff;
+    uint32_t csw;
+    uint32_t tar;
+    uint8_t ram[RAM_SIZE];
+} sim;
+
+const char *info_get_unique_id(void)
+{
+    return "0000000000000000";
+}
+
+const char *info_get_version(void)
+{
+    return "0000";
+}
+
+static uint32_t parity32(uint32_t value)
+{
+    value ^= value >> 16;
+    value ^= value >> 8;
+    value ^= value >> 4;
+    value ^= value >> 2;
+    value ^= value >> 1;
+    return value & 1U;
+}
+
+static uint32_t *ram_word(uint32_t addr)
+{
+    if ((addr < RAM_START) || (addr - RAM_START > RAM_SIZE - 4)) {
+        return NULL;
+    }
+    return (uint32_t *)&sim.ram[(addr - RAM_START) & ~3U];
+}
+
+// Auto increment stays within a 1KB block like on most MEM-APs
+static void tar_increment(void)
+{
+    if ((sim.csw & 0x30) == 0x10) {
+        sim.tar = (sim.tar & ~0x3FFU) | ((sim.tar + 4) & 0x3FFU);
+    }
+}
+
+static uint32_t ap_read(uint32_t reg)
+{
+    uint32_t *word;
+    uint32_t value = 0;
+
+    switch (reg) {
+        case AP_CSW:
+            value = sim.csw;
+            break;
+        case AP_TAR:
+            value = sim.tar;
+            break;
+        case AP_DRW:
+            word = ram_word(sim.tar);
+            value = word ? *word : 0;
+            tar_increment();
+            break;
+        case AP_IDR:
+            value = AP_IDR_VALUE;
+            break;
+    }
+    return value;
+}
+
+static void ap_write(uint32_t reg, uint32_t value)
+{
+    uint32_t *word;
+
+    switch (reg) {
+        case AP_CSW:
+            sim.csw = value;
+            break;
+        case AP_TAR:
+            sim.tar = value;
+            break;
+        case AP_DRW:
+            word = ram_word(sim.tar);
+            if (word) {
+                *word = value;
+            }
+            tar_increment();
+            break;
+    }
+}
+
+static void transfer_start(void)
+{
+    uint32_t addr = sim.request & REQUEST_ADDR;
+
+    if (!(sim.request & DAP_TRANSFER_RnW)) {
+        return;
+    }
+    if (sim.request & DAP_TRANSFER_APnDP) {
+        // AP reads are posted, the result arrives with the next read
+        sim.rdata = sim.rdbuff;
+        sim.rdbuff = ap_read((sim.select & 0xF0) | addr);
+        return;
+    }
+    switch (addr) {
+        case DP_IDCODE:
+            sim.rdata = DP_IDCODE_VALUE;
+            break;
+        case DP_CTRL_STAT:
+            // Power up requests are acknowledged at once
+            sim.rdata = sim.ctrl_stat | ((sim.ctrl_stat & 0x50000000) << 1);
+            break;
+        case DP_SELECT:
+            sim.rdata = 0;
+            break;
+        case DP_RDBUFF:
+            sim.rdata = sim.rdbuff;
+            break;
+    }
+}
+
+static void transfer_end(void)
+{
+    uint32_t addr = sim.request & REQUEST_ADDR;
+
+    if (sim.request & DAP_TRANSFER_RnW) {
+        return;
+    }
+    if (sim.request & DAP_TRANSFER_APnDP) {
+        ap_write((sim.select & 0xF0) | addr, sim.wdata);
+    } else if (addr == DP_CTRL_STAT) {
+        sim.ctrl_stat = sim.wdata;
+    } else if (addr == DP_SELECT) {
+        sim.select = sim.wdata;
+    }
+}
+
+// Start, APnDP, RnW, A2, A3, parity, stop and park in bits 0 to 7
+static int header_valid(uint8_t header)
+{
+    return ((header & 0xC1) == 0x81) && (parity32(header & 0x1E) == ((header >> 5) & 1U));
+}
+
+// Rising SWCLK edge, the target samples the probe and moves to the next cycle
+static void swd_sim_rising_edge(void)
+{
+    if (sim.driving && sim.swdio) {
+        sim.ones++;
+        if (sim.ones >= LINE_RESET_BITS) {
+            sim.busy = 0;
+            sim.header = 0;
+        }
+    } else {
+        sim.ones = 0;
+    }
+
+    if (!sim.busy) {
+        if (!sim.driving) {
+            return;
+        }
+        sim.header = (uint8_t)((sim.header >> 1) | (sim.swdio << 7));
+        if (header_valid(sim.header)) {
+            sim.request = (sim.header >> 1) & 0xF;
+            sim.busy = 1;
+            sim.cycle = 0;
+            sim.header = 0;
+            transfer_start();
+        }
+        return;
+    }
+
+    if (!(sim.request & DAP_TRANSFER_RnW)) {
+        if ((sim.cycle >= CYCLE_WDATA) && (sim.cycle < CYCLE_WPARITY)) {
+            sim.wdata = (sim.wdata >> 1) | (sim.swdio << 31);
+        } else if (sim.cycle == CYCLE_WPARITY) {
+            if (parity32(sim.wdata) == sim.swdio) {
+                transfer_end();
+            }
+        }
+    }
+    sim.cycle++;
+    if (sim.cycle == CYCLE_END) {
+        sim.busy = 0;
+    }
+}
+
+void swd_sim_clock(uint32_t level)
+{
+    if (level && !sim.swclk) {
+        swd_sim_rising_edge();
+    }
+    sim.swclk = level;
+}
+
+void swd_sim_out(uint32_t level)
+{
+    sim.swdio = level;
+}
+
+void swd_sim_out_enable(uint32_t enable)
+{
+    sim.driving = enable;
+}
+
+uint32_t swd_sim_clock_in(void)
+{
+    return sim.swclk;
+}
+
+// Level the target drives in the current cycle
+uint32_t swd_sim_in(void)
+{
+    if (sim.driving) {
+        return sim.swdio;
+    }
+    if (!sim.busy) {
+        return 1U;
+    }
+    if (sim.cycle == CYCLE_ACK) {
+        return 1U;          // ACK OK is 0b001
+    }
+    if ((sim.request & DAP_TRANSFER_RnW) && (sim.cycle >= CYCLE_RDATA)) {
+        if (sim.cycle < CYCLE_RPARITY) {
+            return (sim.rdata >> (sim.cycle - CYCLE_RDATA)) & 1U;
+        }
+        if (sim.cycle == CYCLE_RPARITY) {
+            return parity32(sim.rdata);
+        }
+    }
+    return 0U;
+}
+
+static int read_all(int fd, uint8_t *buf, size_t size)
+{
+    while (size > 0) {
+        ssize_t n = read(fd, buf, size);
+        if (n <= 0) {
+            return 0;
+        }
+        buf += n;
+        size -= n;
+    }
+    return 1;
+}
+
+static int write_all(int fd, const uint8_t *buf, size_t size)
+{
+    while (size > 0) {
+        ssize_t n = write(fd, buf, size);
+        if (n <= 0) {
+            return 0;
+        }
+        buf += n;
+        size -= n;
+    }
+    return 1;
+}
+
+int main(void)
+{
+    static uint8_t request[DAP_PACKET_SIZE];
+    static uint8_t response[DAP_PACKET_SIZE];
+    struct termios tio;
+    uint8_t header[2];
+    uint32_t size;
+    int master;
+    int slave;
+
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if ((master < 0) || (grantpt(master) != 0) || (unlockpt(master) != 0)) {
+        perror("dap_sim: pty");
+        return 1;
+    }
+    // Keep the slave open so reads do not fail before the client opens it
+    slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    if ((slave < 0) || (tcgetattr(slave, &tio) != 0)) {
+        perror("dap_sim: pty");
+        return 1;
+    }
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    DAP_Setup();
+    printf("%s\n", ptsname(master));
+    fflush(stdout);
+
+    while (read_all(master, header, sizeof(header))) {
+        size = header[0] | (header[1] << 8);
+        if ((size == 0) || (size > sizeof(request))) {
+            fprintf(stderr, "dap_sim: bad packet size %u\n", (unsigned)size);
+            return 1;
+        }
+        if (!read_all(master, request, size)) {
+            break;
+        }
+        memset(response, 0, sizeof(response));
+        size = DAP_ExecuteCommand(request, response) & 0xFFFF;
+        header[0] = (uint8_t)size;
+        header[1] = (uint8_t)(size >> 8);
+        if (!write_all(master, header, sizeof(header)) || !write_all(master, response, size)) {
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file    DAP_config.h
+ * @brief   Host stand-in for the HIC DAP_config.h, drives the SWD target simulator
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2021, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DAP_CONFIG_H__
+#define __DAP_CONFIG_H__
+
+#include <stdint.h>
+
+// Same capabilities as a full speed HIC such as the k20dx
+#define CPU_CLOCK               100000000U
+#define IO_PORT_WRITE_CYCLES    2U
+#define DAP_SWD                 1
+#define DAP_JTAG                0
+#define DAP_JTAG_DEV_CNT        0
+#define DAP_DEFAULT_PORT        1U
+#define DAP_DEFAULT_SWJ_CLOCK   1000000U
+#define DAP_PACKET_SIZE         64U
+#define DAP_PACKET_COUNT        5U
+#define SWO_UART                0
+#define SWO_MANCHESTER          0
+#define SWO_BUFFER_SIZE         4096U
+#define SWO_STREAM              0
+#define TIMESTAMP_CLOCK         0U
+#define DAP_UART                0
+#define DAP_UART_USB_COM_PORT   0
+#define TARGET_FIXED            0
+
+// Pin levels and sampling, implemented by the simulator
+void     swd_sim_clock(uint32_t level);
+void     swd_sim_out(uint32_t level);
+void     swd_sim_out_enable(uint32_t enable);
+uint32_t swd_sim_in(void);
+uint32_t swd_sim_clock_in(void);
+
+static inline void PORT_JTAG_SETUP(void)
+{
+}
+
+static inline void PORT_SWD_SETUP(void)
+{
+    swd_sim_clock(1U);
+    swd_sim_out(1U);
+    swd_sim_out_enable(1U);
+}
+
+static inline void PORT_OFF(void)
+{
+    swd_sim_out_enable(0U);
+}
+
+static inline uint32_t PIN_SWCLK_TCK_IN(void)
+{
+    return swd_sim_clock_in();
+}
+
+static inline void PIN_SWCLK_TCK_SET(void)
+{
+    swd_sim_clock(1U);
+}
+
+static inline void PIN_SWCLK_TCK_CLR(void)
+{
+    swd_sim_clock(0U);
+}
+
+static inline uint32_t PIN_SWDIO_TMS_IN(void)
+{
+    return swd_sim_in();
+}
+
+static inline void PIN_SWDIO_TMS_SET(void)
+{
+    swd_sim_out(1U);
+}
+
+static inline void PIN_SWDIO_TMS_CLR(void)
+{
+    swd_sim_out(0U);
+}
+
+static inline uint32_t PIN_SWDIO_IN(void)
+{
+    return swd_sim_in();
+}
+
+static inline void PIN_SWDIO_OUT(uint32_t bit)
+{
+    swd_sim_out(bit & 1U);
+}
+
+static inline void PIN_SWDIO_OUT_ENABLE(void)
+{
+    swd_sim_out_enable(1U);
+}
+
+static inline void PIN_SWDIO_OUT_DISABLE(void)
+{
+    swd_sim_out_enable(0U);
+}
+
+static inline uint32_t PIN_TDI_IN(void)
+{
+    return 0U;
+}
+
+static inline void PIN_TDI_OUT(uint32_t bit)
+{
+}
+
+static inline uint32_t PIN_TDO_IN(void)
+{
+    return 0U;
+}
+
+static inline uint32_t PIN_nTRST_IN(void)
+{
+    return 0U;
+}
+
+static inline void PIN_nTRST_OUT(uint32_t bit)
+{
+}
+
+static inline uint32_t PIN_nRESET_IN(void)
+{
+    return 1U;
+}
+
+static inline void PIN_nRESET_OUT(uint32_t bit)
+{
+}
+
+static inline void LED_CONNECTED_OUT(uint32_t bit)
+{
+}
+
+static inline void LED_RUNNING_OUT(uint32_t bit)
+{
+}
+
+static inline uint32_t TIMESTAMP_GET(void)
+{
+    return 0U;
+}
+
+static inline void DAP_SETUP(void)
+{
+}
+
+static inline uint8_t RESET_TARGET(void)
+{
+    return 0U;
+}
+
+#endif
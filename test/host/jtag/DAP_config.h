@@ -0,0 +1,73 @@
+/**
+ * @file    DAP_config.h
+ * @brief   Host stand-in for the HIC DAP_config.h, drives the JTAG simulator
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2021, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DAP_CONFIG_H__
+#define __DAP_CONFIG_H__
+
+#include <stdint.h>
+
+#define DAP_SWD                 0
+#define DAP_JTAG                1
+#define DAP_JTAG_DEV_CNT        4U
+#define TIMESTAMP_CLOCK         0U
+
+// Pin levels and sampling, implemented by the test
+void     jtag_sim_tck(uint32_t level);
+void     jtag_sim_tms(uint32_t level);
+void     jtag_sim_tdi(uint32_t level);
+uint32_t jtag_sim_tdo(void);
+
+static inline void PIN_SWCLK_TCK_SET(void)
+{
+    jtag_sim_tck(1U);
+}
+
+static inline void PIN_SWCLK_TCK_CLR(void)
+{
+    jtag_sim_tck(0U);
+}
+
+static inline void PIN_SWDIO_TMS_SET(void)
+{
+    jtag_sim_tms(1U);
+}
+
+static inline void PIN_SWDIO_TMS_CLR(void)
+{
+    jtag_sim_tms(0U);
+}
+
+static inline void PIN_TDI_OUT(uint32_t bit)
+{
+    jtag_sim_tdi(bit & 1U);
+}
+
+static inline uint32_t PIN_TDO_IN(void)
+{
+    return jtag_sim_tdo();
+}
+
+static inline uint32_t TIMESTAMP_GET(void)
+{
+    return 0U;
+}
+
+#endif
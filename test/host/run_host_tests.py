@@ -0,0 +1,113 @@
+#
+# DAPLink Interface Firmware
+# Copyright (c) 2021, ARM Limited, All Rights Reserved
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+"""Build and run the firmware modules that have host tests.
+
+Each test is a C file in this directory compiled together with the firmware
+sources it covers, using the host compiler. No board is needed. Running all
+tests also checks that the CMSIS-DAP simulator used by test/benchmark.py
+still builds.
+
+Example:
+  python test/host/run_host_tests.py
+  python test/host/run_host_tests.py --cc clang swo_decode
+"""
+
+from __future__ import absolute_import
+from __future__ import print_function
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+
+HOST_DIR = os.path.dirname(os.path.abspath(__file__))
+ROOT_DIR = os.path.normpath(os.path.join(HOST_DIR, "..", ".."))
+
+# Test name: (firmware sources, include directories), relative to the repo root
+TESTS = {
+    "swo_decode": (
+        ["source/daplink/cmsis-dap/swo_decode.c"],
+        ["source/daplink/cmsis-dap"],
+    ),
+    "jtag_dp": (
+        ["source/daplink/cmsis-dap/JTAG_DP.c"],
+        ["test/host/jtag", "source/daplink/cmsis-dap"],
+    ),
+}
+
+# CMSIS-DAP firmware serving commands over a pty, used by test/benchmark.py.
+# DAP.c and SW_DP.c are built with the warnings they have on the host.
+DAP_SIM = (
+    ["source/daplink/cmsis-dap/DAP.c", "source/daplink/cmsis-dap/SW_DP.c"],
+    ["test/host/dap_sim", "source/daplink/cmsis-dap", "source/daplink",
+     "source/daplink/drag-n-drop", "source/target", "source/hic_hal"],
+    ["-Wno-unused-variable", "-Wno-unknown-pragmas"],
+)
+
+CFLAGS = ["-std=gnu99", "-Wall", "-Werror", "-O1", "-g"]
+
+
+def build(cc, main_source, sources, includes, exe, cflags=()):
+    """Build main_source from this directory with firmware sources, return True on success"""
+    args = [cc] + CFLAGS + list(cflags) + ["-I" + HOST_DIR]
+    args += ["-I" + os.path.join(ROOT_DIR, inc) for inc in includes]
+    args += [os.path.join(HOST_DIR, main_source)]
+    args += [os.path.join(ROOT_DIR, src) for src in sources]
+    return subprocess.call(args + ["-o", exe]) == 0
+
+
+def build_dap_sim(cc, exe):
+    sources, includes, cflags = DAP_SIM
+    return build(cc, "dap_sim.c", sources, includes, exe, cflags)
+
+
+def run_test(cc, name):
+    sources, includes = TESTS[name]
+    with tempfile.TemporaryDirectory() as build_dir:
+        exe = os.path.join(build_dir, "test_" + name)
+        if not build(cc, "test_%s.c" % name, sources, includes, exe):
+            print("%s: build failed" % name)
+            return False
+        return subprocess.call([exe]) == 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="DAPLink host tests")
+    parser.add_argument("--cc", default=os.environ.get("CC", "gcc"), help="Host C compiler")
+    parser.add_argument("tests", nargs="*", help="Tests to run, default all of %s" % ", ".join(sorted(TESTS)))
+    args = parser.parse_args()
+    for name in args.tests:
+        if name not in TESTS:
+            parser.error("unknown test %s" % name)
+
+    failed = [name for name in (args.tests or sorted(TESTS)) if not run_test(args.cc, name)]
+    if not args.tests:
+        # Not run here, but keep it building
+        with tempfile.TemporaryDirectory() as build_dir:
+            if not build_dap_sim(args.cc, os.path.join(build_dir, "dap_sim")):
+                failed.append("dap_sim")
+    if failed:
+        print("Failed: " + ", ".join(failed))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,465 @@
+/**
+ * @file    test_jtag_dp.c
+ * @brief   Host tests for the JTAG IR cache and Update-DR chaining
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2021, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "host_test.h"
+#include "DAP_config.h"
+#include "DAP.h"
+
+// JTAG-DP instructions
+#define IR_ABORT        0x8
+#define IR_DPACC        0xA
+#define IR_APACC        0xB
+#define IR_IDCODE       0xE
+
+#define DP_IDCODE_VALUE 0x4BA00477
+#define DP_SELECT_REQ   (DAP_TRANSFER_A3)
+#define DP_RDBUFF_REQ   (DAP_TRANSFER_A2 | DAP_TRANSFER_A3)
+
+// Cost of one IR scan from Run-Test/Idle on the two device chain below:
+// 4 TCK to Shift-IR, 9 IR bits, Update-IR and Idle
+#define IR_SCAN_TCK     15
+// Cost of one DPACC/APACC scan: 3 TCK to Shift-DR, 35 bits plus the
+// bypass bit of the second device, and Update-DR
+#define DR_SCAN_TCK     40
+
+DAP_Data_t DAP_Data;
+
+typedef enum {
+    TLR, RTI, SEL_DR, CAP_DR, SH_DR, EX1_DR, PA_DR, EX2_DR, UPD_DR,
+    SEL_IR, CAP_IR, SH_IR, EX1_IR, PA_IR, EX2_IR, UPD_IR
+} tap_state_t;
+
+// IEEE 1149.1 state transitions, indexed by state and TMS
+static const tap_state_t tap_next[16][2] = {
+    [TLR]    = { RTI,    TLR    },
+    [RTI]    = { RTI,    SEL_DR },
+    [SEL_DR] = { CAP_DR, SEL_IR },
+    [CAP_DR] = { SH_DR,  EX1_DR },
+    [SH_DR]  = { SH_DR,  EX1_DR },
+    [EX1_DR] = { PA_DR,  UPD_DR },
+    [PA_DR]  = { PA_DR,  EX2_DR },
+    [EX2_DR] = { SH_DR,  UPD_DR },
+    [UPD_DR] = { RTI,    SEL_DR },
+    [SEL_IR] = { CAP_IR, TLR    },
+    [CAP_IR] = { SH_IR,  EX1_IR },
+    [SH_IR]  = { SH_IR,  EX1_IR },
+    [EX1_IR] = { PA_IR,  UPD_IR },
+    [PA_IR]  = { PA_IR,  EX2_IR },
+    [EX2_IR] = { SH_IR,  UPD_IR },
+    [UPD_IR] = { RTI,    SEL_DR },
+};
+
+// One TAP of the chain. Device 0 is next to TDO.
+typedef struct {
+    uint8_t ir_len;
+    uint8_t is_dp;          // ARM JTAG-DP, otherwise only BYPASS
+    uint32_t ir;
+    uint64_t shift;
+    uint8_t shift_len;
+} tap_t;
+
+static struct {
+    tap_t tap[2];
+    tap_state_t state;
+    uint32_t tck;
+    uint32_t tms;
+    uint32_t tdi;
+    uint32_t tck_count;
+    uint32_t dp_reg[4];
+    uint32_t ap_reg[4];
+    uint32_t rdata;         // Returned by the next DPACC/APACC capture
+    uint32_t abort;
+} sim;
+
+static void tap_reset_ir(void)
+{
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        sim.tap[i].ir = sim.tap[i].is_dp ? IR_IDCODE : (1U << sim.tap[i].ir_len) - 1;
+    }
+}
+
+static void capture_dr(tap_t *tap)
+{
+    if (!tap->is_dp) {
+        tap->shift = 0;
+        tap->shift_len = 1;
+        return;
+    }
+    switch (tap->ir) {
+        case IR_DPACC:
+        case IR_APACC:
+            // ACK OK/FAULT is 0b010
+            tap->shift = ((uint64_t)sim.rdata << 3) | 0x2;
+            tap->shift_len = 35;
+            break;
+        case IR_ABORT:
+            tap->shift = 0;
+            tap->shift_len = 35;
+            break;
+        case IR_IDCODE:
+            tap->shift = DP_IDCODE_VALUE;
+            tap->shift_len = 32;
+            break;
+        default:
+            tap->shift = 0;
+            tap->shift_len = 1;
+            break;
+    }
+}
+
+static void update_dr(tap_t *tap)
+{
+    uint32_t rnw = tap->shift & 1;
+    uint32_t a = (uint32_t)(tap->shift >> 1) & 0x3;
+    uint32_t data = (uint32_t)(tap->shift >> 3);
+    uint32_t *regs;
+
+    if (!tap->is_dp || (tap->shift_len != 35)) {
+        return;
+    }
+    if (tap->ir == IR_ABORT) {
+        sim.abort = data;
+        return;
+    }
+    regs = (tap->ir == IR_APACC) ? sim.ap_reg : sim.dp_reg;
+    if (!rnw) {
+        regs[a] = data;
+    } else if ((tap->ir == IR_APACC) || (a != 3)) {
+        // Reading RDBUFF returns the previous result again
+        sim.rdata = regs[a];
+    }
+}
+
+static void shift_chain(void)
+{
+    uint32_t in = sim.tdi;
+    int i;
+
+    // TDI enters the device furthest from TDO
+    for (i = 1; i >= 0; i--) {
+        tap_t *tap = &sim.tap[i];
+        uint32_t out = tap->shift & 1;
+        tap->shift = (tap->shift >> 1) | ((uint64_t)in << (tap->shift_len - 1));
+        in = out;
+    }
+}
+
+static void tck_rising(void)
+{
+    int i;
+
+    sim.tck_count++;
+    switch (sim.state) {
+        case CAP_DR:
+            for (i = 0; i < 2; i++) {
+                capture_dr(&sim.tap[i]);
+            }
+            break;
+        case CAP_IR:
+            for (i = 0; i < 2; i++) {
+                sim.tap[i].shift = 0x1;
+                sim.tap[i].shift_len = sim.tap[i].ir_len;
+            }
+            break;
+        case SH_DR:
+        case SH_IR:
+            shift_chain();
+            break;
+        default:
+            break;
+    }
+
+    sim.state = tap_next[sim.state][sim.tms];
+    if (sim.state == TLR) {
+        tap_reset_ir();
+    } else if (sim.state == UPD_IR) {
+        for (i = 0; i < 2; i++) {
+            sim.tap[i].ir = (uint32_t)sim.tap[i].shift;
+        }
+    } else if (sim.state == UPD_DR) {
+        for (i = 0; i < 2; i++) {
+            update_dr(&sim.tap[i]);
+        }
+    }
+}
+
+void jtag_sim_tck(uint32_t level)
+{
+    if (level && !sim.tck) {
+        tck_rising();
+    }
+    sim.tck = level;
+}
+
+void jtag_sim_tms(uint32_t level)
+{
+    sim.tms = level;
+}
+
+void jtag_sim_tdi(uint32_t level)
+{
+    sim.tdi = level;
+}
+
+uint32_t jtag_sim_tdo(void)
+{
+    if ((sim.state == SH_DR) || (sim.state == SH_IR)) {
+        return sim.tap[0].shift & 1;
+    }
+    return 1;
+}
+
+// DP with a 4 bit IR next to TDO, followed by a device with a 5 bit IR.
+// Both TAPs rest in Run-Test/Idle and the engine knows nothing about them.
+static void setup(void)
+{
+    memset(&sim, 0, sizeof(sim));
+    sim.tap[0].ir_len = 4;
+    sim.tap[0].is_dp = 1;
+    sim.tap[1].ir_len = 5;
+    tap_reset_ir();
+    sim.state = RTI;
+    sim.tck = 1;
+
+    memset(&DAP_Data, 0, sizeof(DAP_Data));
+    DAP_Data.fast_clock = 1;
+    DAP_Data.clock_delay = 1;
+    DAP_Data.jtag_dev.count = 2;
+    DAP_Data.jtag_dev.index = 0;
+    DAP_Data.jtag_dev.ir_length[0] = 4;
+    DAP_Data.jtag_dev.ir_length[1] = 5;
+    DAP_Data.jtag_dev.ir_before[0] = 0;
+    DAP_Data.jtag_dev.ir_before[1] = 4;
+    DAP_Data.jtag_dev.ir_after[0] = 5;
+    DAP_Data.jtag_dev.ir_after[1] = 0;
+    JTAG_IR_Invalidate();
+    JTAG_Idle();
+}
+
+// TCK cycles spent by the last call
+static uint32_t tck_since(uint32_t *mark)
+{
+    uint32_t count = sim.tck_count - *mark;
+    *mark = sim.tck_count;
+    return count;
+}
+
+static void test_ir_scan(void)
+{
+    uint32_t mark = 0;
+
+    setup();
+    JTAG_IR(IR_DPACC);
+    CHECK_EQ(tck_since(&mark), IR_SCAN_TCK);
+    CHECK_EQ(sim.tap[0].ir, IR_DPACC);
+    CHECK_EQ(sim.tap[1].ir, 0x1F);
+    CHECK_EQ(sim.state, RTI);
+
+    // The slow clock path scans the same way
+    setup();
+    mark = 0;
+    DAP_Data.fast_clock = 0;
+    JTAG_IR(IR_APACC);
+    CHECK_EQ(tck_since(&mark), IR_SCAN_TCK);
+    CHECK_EQ(sim.tap[0].ir, IR_APACC);
+    CHECK_EQ(sim.state, RTI);
+}
+
+static void test_ir_cache_skips_rescan(void)
+{
+    uint32_t mark = 0;
+
+    setup();
+    JTAG_IR(IR_DPACC);
+    tck_since(&mark);
+
+    JTAG_IR(IR_DPACC);
+    CHECK_EQ(tck_since(&mark), 0);
+
+    JTAG_IR(IR_APACC);
+    CHECK_EQ(tck_since(&mark), IR_SCAN_TCK);
+    CHECK_EQ(sim.tap[0].ir, IR_APACC);
+
+    JTAG_IR_Invalidate();
+    JTAG_IR(IR_APACC);
+    CHECK_EQ(tck_since(&mark), IR_SCAN_TCK);
+    CHECK_EQ(sim.state, RTI);
+}
+
+static void test_ir_cache_follows_index(void)
+{
+    uint32_t mark = 0;
+
+    setup();
+    JTAG_IR(IR_DPACC);
+    tck_since(&mark);
+
+    // Selecting the other device puts the DP in BYPASS
+    DAP_Data.jtag_dev.index = 1;
+    JTAG_IR(IR_DPACC);
+    CHECK_EQ(tck_since(&mark), IR_SCAN_TCK);
+    CHECK_EQ(sim.tap[0].ir, 0xF);
+    CHECK_EQ(sim.tap[1].ir, IR_DPACC);
+
+    DAP_Data.jtag_dev.index = 0;
+    JTAG_IR(IR_DPACC);
+    CHECK_EQ(tck_since(&mark), IR_SCAN_TCK);
+    CHECK_EQ(sim.tap[0].ir, IR_DPACC);
+    CHECK_EQ(sim.tap[1].ir, 0x1F);
+}
+
+static void test_sequence_invalidates_ir(void)
+{
+    uint32_t mark = 0;
+    uint8_t ones = 0xFF;
+    uint8_t zero = 0x00;
+
+    setup();
+    JTAG_IR(IR_DPACC);
+
+    // Test-Logic-Reset and back to Run-Test/Idle
+    JTAG_Sequence(JTAG_SEQUENCE_TMS | 5, &ones, NULL);
+    JTAG_Sequence(1, &zero, NULL);
+    CHECK_EQ(sim.state, RTI);
+    CHECK_EQ(sim.tap[0].ir, IR_IDCODE);
+    tck_since(&mark);
+
+    JTAG_IR(IR_DPACC);
+    CHECK_EQ(tck_since(&mark), IR_SCAN_TCK);
+    CHECK_EQ(sim.tap[0].ir, IR_DPACC);
+}
+
+static void test_transfer_chains_update_dr(void)
+{
+    uint32_t mark = 0;
+    uint32_t data;
+
+    setup();
+    JTAG_IR(IR_DPACC);
+    tck_since(&mark);
+
+    // Without idle cycles back-to-back scans start from Update-DR
+    data = 0x11111111;
+    CHECK_EQ(JTAG_Transfer(DP_SELECT_REQ, &data), DAP_TRANSFER_OK);
+    CHECK_EQ(tck_since(&mark), DR_SCAN_TCK);
+    CHECK_EQ(sim.state, UPD_DR);
+    data = 0x22222222;
+    CHECK_EQ(JTAG_Transfer(DP_SELECT_REQ, &data), DAP_TRANSFER_OK);
+    CHECK_EQ(tck_since(&mark), DR_SCAN_TCK);
+    CHECK_EQ(sim.state, UPD_DR);
+    CHECK_EQ(sim.dp_reg[2], 0x22222222);
+
+    // The end of the command returns to Run-Test/Idle exactly once
+    JTAG_Idle();
+    CHECK_EQ(tck_since(&mark), 1);
+    CHECK_EQ(sim.state, RTI);
+    JTAG_Idle();
+    CHECK_EQ(tck_since(&mark), 0);
+
+    // An IR scan after a chained transfer also starts from Update-DR
+    data = 0x33333333;
+    JTAG_Transfer(DP_SELECT_REQ, &data);
+    tck_since(&mark);
+    JTAG_IR(IR_APACC);
+    CHECK_EQ(tck_since(&mark), IR_SCAN_TCK);
+    CHECK_EQ(sim.tap[0].ir, IR_APACC);
+    CHECK_EQ(sim.state, RTI);
+    JTAG_Idle();
+    CHECK_EQ(tck_since(&mark), 0);
+}
+
+static void test_transfer_idle_cycles(void)
+{
+    uint32_t mark = 0;
+    uint32_t data = 0x44444444;
+
+    setup();
+    DAP_Data.transfer.idle_cycles = 2;
+    JTAG_IR(IR_DPACC);
+    tck_since(&mark);
+
+    CHECK_EQ(JTAG_Transfer(DP_SELECT_REQ, &data), DAP_TRANSFER_OK);
+    CHECK_EQ(tck_since(&mark), DR_SCAN_TCK + 1 + 2);
+    CHECK_EQ(sim.state, RTI);
+    JTAG_Idle();
+    CHECK_EQ(tck_since(&mark), 0);
+    CHECK_EQ(sim.dp_reg[2], 0x44444444);
+}
+
+static void test_transfer_read(void)
+{
+    uint32_t data = 0x12345678;
+
+    setup();
+    JTAG_IR(IR_DPACC);
+    CHECK_EQ(JTAG_Transfer(DP_SELECT_REQ, &data), DAP_TRANSFER_OK);
+    data = 0;
+    CHECK_EQ(JTAG_Transfer(DP_SELECT_REQ | DAP_TRANSFER_RnW, &data), DAP_TRANSFER_OK);
+    CHECK_EQ(JTAG_Transfer(DP_RDBUFF_REQ | DAP_TRANSFER_RnW, &data), DAP_TRANSFER_OK);
+    CHECK_EQ(data, 0x12345678);
+    JTAG_Idle();
+
+    JTAG_IR(IR_IDCODE);
+    CHECK_EQ(JTAG_ReadIDCode(), DP_IDCODE_VALUE);
+    CHECK_EQ(sim.state, RTI);
+}
+
+static void test_bad_ack_invalidates_ir(void)
+{
+    uint32_t mark = 0;
+    uint32_t data = 0;
+
+    setup();
+    JTAG_IR(IR_DPACC);
+
+    // The TAP lost its IR behind the engine's back, the cached IR hides it
+    tap_reset_ir();
+    tck_since(&mark);
+    JTAG_IR(IR_DPACC);
+    CHECK_EQ(tck_since(&mark), 0);
+
+    // The IDCODE register answers instead, which is no valid ACK
+    CHECK(JTAG_Transfer(DP_SELECT_REQ | DAP_TRANSFER_RnW, &data) != DAP_TRANSFER_OK);
+    JTAG_Idle();
+    tck_since(&mark);
+
+    JTAG_IR(IR_DPACC);
+    CHECK_EQ(tck_since(&mark), IR_SCAN_TCK);
+    CHECK_EQ(sim.tap[0].ir, IR_DPACC);
+    CHECK_EQ(JTAG_Transfer(DP_SELECT_REQ | DAP_TRANSFER_RnW, &data), DAP_TRANSFER_OK);
+}
+
+int main(void)
+{
+    RUN_TEST(test_ir_scan);
+    RUN_TEST(test_ir_cache_skips_rescan);
+    RUN_TEST(test_ir_cache_follows_index);
+    RUN_TEST(test_sequence_invalidates_ir);
+    RUN_TEST(test_transfer_chains_update_dr);
+    RUN_TEST(test_transfer_idle_cycles);
+    RUN_TEST(test_transfer_read);
+    RUN_TEST(test_bad_ack_invalidates_ir);
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,408 @@
+/**
+ * @file    test_swo_decode.c
+ * @brief   Host tests for the SWO Manchester decoder and baudrate detection
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2021, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "swo_decode.h"
+
+#define MAX_PERIODS     20000
+#define MAX_BYTES       1024
+
+// Synthetic SWO line as the capture interrupt reports it: the level and
+// length of every period between two edges.
+typedef struct {
+    uint32_t level[MAX_PERIODS];
+    uint32_t ticks[MAX_PERIODS];
+    uint32_t count;
+    double time;            // Exact time of the end of the waveform so far
+    uint32_t last_edge;     // Rounded time of the last edge
+    uint32_t cur_level;
+    double half;            // Manchester half-bit length
+    double half_step;       // Added to half after every half-bit, models drift
+    uint32_t jitter;        // Random edge displacement in ticks, up to +-jitter
+} train_t;
+
+static train_t train;
+
+static void train_init(uint32_t idle_level, double half)
+{
+    memset(&train, 0, sizeof(train));
+    train.cur_level = idle_level;
+    train.half = half;
+    srand(1);
+}
+
+static void train_edge(void)
+{
+    int32_t edge = (int32_t)(train.time + 0.5);
+
+    if (train.jitter) {
+        edge += (rand() % (2 * train.jitter + 1)) - (int32_t)train.jitter;
+    }
+    if (train.count < MAX_PERIODS) {
+        train.level[train.count] = train.cur_level;
+        train.ticks[train.count] = edge - train.last_edge;
+        train.count++;
+    }
+    train.last_edge = edge;
+}
+
+static void train_level(uint32_t level, double duration)
+{
+    if (level != train.cur_level) {
+        train_edge();
+        train.cur_level = level;
+    }
+    train.time += duration;
+}
+
+// Close the last period so it is reported like the capture would at the next edge
+static void train_end(void)
+{
+    train_edge();
+}
+
+static void manchester_bit(uint32_t bit)
+{
+    train_level(bit, train.half);
+    train.half += train.half_step;
+    train_level(!bit, train.half);
+    train.half += train.half_step;
+}
+
+static void manchester_packet(const uint8_t *data, uint32_t size)
+{
+    uint32_t i;
+    uint32_t b;
+
+    manchester_bit(1);
+    for (i = 0; i < size; i++) {
+        for (b = 0; b < 8; b++) {
+            manchester_bit((data[i] >> b) & 1);
+        }
+    }
+}
+
+static void manchester_idle(double halves)
+{
+    train_level(0, train.half * halves);
+}
+
+static uint32_t decode_train(swo_manchester_t *dec, uint8_t *out)
+{
+    uint32_t i;
+    uint32_t n = 0;
+
+    for (i = 0; i < train.count; i++) {
+        if (swo_manchester_decode(dec, train.level[i], train.ticks[i], &out[n]) && (n < MAX_BYTES)) {
+            n++;
+        }
+    }
+    return n;
+}
+
+static void uart_byte(double bit, uint8_t data)
+{
+    uint32_t b;
+
+    train_level(0, bit);
+    for (b = 0; b < 8; b++) {
+        train_level((data >> b) & 1, bit);
+    }
+    train_level(1, bit);
+}
+
+static void test_manchester_all_bytes(void)
+{
+    swo_manchester_t dec;
+    uint8_t out[MAX_BYTES];
+    uint8_t data;
+    uint32_t i;
+
+    train_init(0, 10);
+    manchester_idle(20);
+    for (i = 0; i < 256; i++) {
+        data = i;
+        manchester_packet(&data, 1);
+        manchester_idle(6);
+    }
+    train_end();
+
+    swo_manchester_init(&dec, 10);
+    CHECK_EQ(decode_train(&dec, out), 256);
+    for (i = 0; i < 256; i++) {
+        CHECK_EQ(out[i], i);
+    }
+    CHECK_EQ(dec.errors, 0);
+}
+
+static void test_manchester_multi_byte_packet(void)
+{
+    static const uint8_t packet[] = {0x03, 0x41, 0x42, 0xc3, 0x00};
+    swo_manchester_t dec;
+    uint8_t out[MAX_BYTES];
+
+    train_init(0, 16);
+    manchester_idle(20);
+    manchester_packet(packet, sizeof(packet));
+    manchester_idle(6);
+    manchester_packet(packet, sizeof(packet));
+    manchester_idle(6);
+    train_end();
+
+    swo_manchester_init(&dec, 16);
+    CHECK_EQ(decode_train(&dec, out), 2 * sizeof(packet));
+    CHECK(memcmp(out, packet, sizeof(packet)) == 0);
+    CHECK(memcmp(out + sizeof(packet), packet, sizeof(packet)) == 0);
+    CHECK_EQ(dec.errors, 0);
+}
+
+// Target clock changes between packets, each start bit sets the new timing
+static void test_manchester_drift_between_packets(void)
+{
+    swo_manchester_t dec;
+    uint8_t out[MAX_BYTES];
+    uint8_t data;
+    uint32_t i;
+
+    train_init(0, 10);
+    manchester_idle(40);
+    for (i = 0; i < 64; i++) {
+        train.half = 8.0 + i * 0.1;     // 8 to 14.3 ticks
+        data = 0xa5 ^ i;
+        manchester_packet(&data, 1);
+        manchester_idle(6);
+    }
+    train_end();
+
+    swo_manchester_init(&dec, 10);
+    CHECK_EQ(decode_train(&dec, out), 64);
+    for (i = 0; i < 64; i++) {
+        CHECK_EQ(out[i], 0xa5 ^ i);
+    }
+    CHECK_EQ(dec.errors, 0);
+}
+
+// Target clock drifts by 15% over one long packet
+static void test_manchester_drift_within_packet(void)
+{
+    uint8_t packet[16];
+    swo_manchester_t dec;
+    uint8_t out[MAX_BYTES];
+    uint32_t i;
+
+    for (i = 0; i < sizeof(packet); i++) {
+        packet[i] = (uint8_t)(i * 37 + 1);
+    }
+    train_init(0, 12);
+    manchester_idle(20);
+    train.half_step = 12 * 0.15 / (2 * (8 * sizeof(packet) + 1));
+    manchester_packet(packet, sizeof(packet));
+    train.half_step = 0;
+    manchester_idle(6);
+    train_end();
+
+    swo_manchester_init(&dec, 12);
+    CHECK_EQ(decode_train(&dec, out), sizeof(packet));
+    CHECK(memcmp(out, packet, sizeof(packet)) == 0);
+    CHECK_EQ(dec.errors, 0);
+}
+
+static void test_manchester_jitter(void)
+{
+    swo_manchester_t dec;
+    uint8_t out[MAX_BYTES];
+    uint8_t data;
+    uint32_t i;
+
+    // Capture latency, every edge may be off by a tick on top of the rounding
+    train_init(0, 20);
+    train.jitter = 1;
+    manchester_idle(20);
+    for (i = 0; i < 128; i++) {
+        data = (uint8_t)(i * 13);
+        manchester_packet(&data, 1);
+        manchester_idle(6);
+    }
+    train_end();
+
+    swo_manchester_init(&dec, 20);
+    CHECK_EQ(decode_train(&dec, out), 128);
+    for (i = 0; i < 128; i++) {
+        CHECK_EQ(out[i], (uint8_t)(i * 13));
+    }
+    CHECK_EQ(dec.errors, 0);
+}
+
+// A bit without a transition in the middle is an error, the next packet decodes
+static void test_manchester_error_recovery(void)
+{
+    swo_manchester_t dec;
+    uint8_t out[MAX_BYTES];
+    uint8_t data = 0x5a;
+
+    train_init(0, 10);
+    manchester_idle(20);
+    manchester_bit(1);
+    manchester_bit(0);
+    train_level(1, 30);                 // Three high halves
+    manchester_bit(1);
+    manchester_idle(6);
+    manchester_packet(&data, 1);
+    manchester_idle(6);
+    train_end();
+
+    swo_manchester_init(&dec, 10);
+    CHECK_EQ(decode_train(&dec, out), 1);
+    CHECK_EQ(out[0], 0x5a);
+    CHECK(dec.errors > 0);
+}
+
+// Capture started in the middle of a packet, nothing is decoded until the line is idle
+static void test_manchester_sync(void)
+{
+    swo_manchester_t dec;
+    uint8_t out[MAX_BYTES];
+    uint8_t data = 0x3c;
+    uint32_t i;
+
+    train_init(0, 10);
+    for (i = 0; i < 40; i++) {
+        manchester_bit((i * 7 / 3) & 1);
+    }
+    manchester_idle(20);
+    manchester_packet(&data, 1);
+    manchester_idle(6);
+    train_end();
+
+    swo_manchester_init(&dec, 10);
+    CHECK_EQ(decode_train(&dec, out), 1);
+    CHECK_EQ(out[0], 0x3c);
+}
+
+static void feed_autobaud(swo_autobaud_t *ab, uint32_t count)
+{
+    uint32_t i;
+
+    for (i = 0; i < count && i < train.count; i++) {
+        swo_autobaud_put(ab, train.ticks[i]);
+    }
+}
+
+static int within(uint32_t value, uint32_t expected, uint32_t permille)
+{
+    uint64_t diff = (value > expected) ? value - expected : expected - value;
+    return diff * 1000 <= (uint64_t)expected * permille;
+}
+
+static void test_autobaud_uart(void)
+{
+    static const uint32_t bauds[] = {9600, 115200, 1000000, 3000000};
+    const uint32_t clock = 48000000;
+    swo_autobaud_t ab;
+    uint32_t i;
+    uint32_t j;
+
+    for (i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++) {
+        double bit = (double)clock / bauds[i];
+        train_init(1, 0);
+        train_level(1, 10 * bit);
+        for (j = 0; j < 64; j++) {
+            uart_byte(bit, (uint8_t)(j * 73 + 0x55));
+        }
+        train_end();
+
+        swo_autobaud_init(&ab);
+        feed_autobaud(&ab, SWO_AUTOBAUD_EDGES - 1);
+        CHECK_EQ(swo_autobaud_get(&ab, clock, 1), 0);
+
+        swo_autobaud_init(&ab);
+        feed_autobaud(&ab, train.count);
+        CHECK(within(swo_autobaud_get(&ab, clock, 1), bauds[i], 10));
+    }
+}
+
+static void test_autobaud_manchester(void)
+{
+    static const uint32_t bauds[] = {500000, 2000000, 6000000};
+    const uint32_t clock = 72000000;
+    swo_autobaud_t ab;
+    uint8_t data;
+    uint32_t i;
+    uint32_t j;
+
+    for (i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++) {
+        train_init(0, (double)clock / bauds[i] / 2);
+        manchester_idle(20);
+        for (j = 0; j < 32; j++) {
+            data = (uint8_t)(j * 29);
+            manchester_packet(&data, 1);
+            manchester_idle(6);
+        }
+        train_end();
+
+        swo_autobaud_init(&ab);
+        feed_autobaud(&ab, train.count);
+        CHECK(within(swo_autobaud_get(&ab, clock, 2), bauds[i], 20));
+    }
+}
+
+// Edge jitter and a slowly drifting clock still give the average baudrate
+static void test_autobaud_drift(void)
+{
+    const uint32_t clock = 72000000;
+    const uint32_t baud = 2000000;
+    swo_autobaud_t ab;
+    uint8_t data;
+    uint32_t j;
+
+    train_init(0, (double)clock / baud / 2);
+    train.jitter = 1;
+    manchester_idle(20);
+    for (j = 0; j < 32; j++) {
+        train.half = (double)clock / baud / 2 * (0.98 + j * 0.04 / 32);
+        data = (uint8_t)(j * 29);
+        manchester_packet(&data, 1);
+        manchester_idle(6);
+    }
+    train_end();
+
+    swo_autobaud_init(&ab);
+    feed_autobaud(&ab, train.count);
+    CHECK(within(swo_autobaud_get(&ab, clock, 2), baud, 40));
+}
+
+int main(void)
+{
+    RUN_TEST(test_manchester_all_bytes);
+    RUN_TEST(test_manchester_multi_byte_packet);
+    RUN_TEST(test_manchester_drift_between_packets);
+    RUN_TEST(test_manchester_drift_within_packet);
+    RUN_TEST(test_manchester_jitter);
+    RUN_TEST(test_manchester_error_recovery);
+    RUN_TEST(test_manchester_sync);
+    RUN_TEST(test_autobaud_uart);
+    RUN_TEST(test_autobaud_manchester);
+    RUN_TEST(test_autobaud_drift);
+    return HOST_TEST_RESULT();
+}
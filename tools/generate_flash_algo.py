@@ -120,16 +120,153 @@ static const program_target_t flash = {
     // address of prog_blob
     {{name}}_flash_prog_blob,
     // ram_to_flash_bytes_to_be_written
-    {{'0x%08x' % algo.page_size}}
+    {{'0x%08x' % program_buffer_size}}
 };
 
 """
 
+# Limits for --profile
+PROFILE_MAX_INSTRUCTIONS = 10000000
+PROFILE_PERIPHERAL_VALUE = 0xFFFFFFFF
+# Memory that is not the algo, its RAM or flash is treated as peripherals
+PROFILE_PAGE = 0x1000
+
 colorama.init()
 
 def str_to_num(val):
     return int(val, 0)  #convert string to number and automatically handle hex conversion
 
+class FlashAlgoProfiler(object):
+    """
+    Run flash algo functions in a Cortex-M emulator
+
+    The flash is modelled as plain memory that starts erased, so algos that
+    program by writing to the flash array can be checked for the data they
+    wrote. Peripheral registers are mapped on first access and every read
+    returns a fixed value, which should be chosen so the algo's status
+    polling completes (e.g. ready bits set, error bits clear). Functions
+    that do not return within the instruction limit are reported as such.
+    """
+
+    def __init__(self, algo, entry, static_base, stack_pointer, periph_value, max_instructions):
+        try:
+            import unicorn
+            from unicorn import arm_const
+        except ImportError:
+            raise Exception("--profile needs the unicorn package (pip install unicorn)")
+        self._uc = unicorn
+        self._regs = arm_const
+        self.algo = algo
+        self.entry = entry
+        self.static_base = static_base
+        self.stack_pointer = stack_pointer
+        self.periph_value = periph_value
+        self.max_instructions = max_instructions
+        self.instructions = 0
+
+        self.mu = unicorn.Uc(unicorn.UC_ARCH_ARM, unicorn.UC_MODE_THUMB | unicorn.UC_MODE_MCLASS)
+        # RAM: header, algo, stack and a buffer of up to one sector
+        sector_size = max(size for _, size in algo.sector_sizes)
+        self._map(entry, stack_pointer + sector_size - entry)
+        self.mu.mem_write(entry, struct.pack("<I", int(BLOB_HEADER.rstrip(","), 16)) + bytes(algo.algo_data))
+        # Flash, erased
+        self._map(algo.flash_start, algo.flash_size, b"\xff")
+
+        self.mu.hook_add(unicorn.UC_HOOK_CODE, self._count)
+        self.mu.hook_add(unicorn.UC_HOOK_MEM_UNMAPPED, self._map_peripheral)
+
+    def _map(self, start, size, fill=b"\x00"):
+        base = start // PROFILE_PAGE * PROFILE_PAGE
+        size = (start + size - base + PROFILE_PAGE - 1) // PROFILE_PAGE * PROFILE_PAGE
+        self.mu.mem_map(base, size)
+        self.mu.mem_write(base, fill * size)
+
+    def _count(self, mu, address, size, user_data):
+        self.instructions += 1
+        if self.instructions >= self.max_instructions:
+            mu.emu_stop()
+
+    def _map_peripheral(self, mu, access, address, size, value, user_data):
+        base = address // PROFILE_PAGE * PROFILE_PAGE
+        mu.mem_map(base, PROFILE_PAGE)
+        mu.mem_write(base, struct.pack("<I", self.periph_value) * (PROFILE_PAGE // 4))
+        mu.hook_add(self._uc.UC_HOOK_MEM_READ, self._read_peripheral, begin=base, end=base + PROFILE_PAGE - 1)
+        return True
+
+    def _read_peripheral(self, mu, access, address, size, value, user_data):
+        mu.mem_write(address, struct.pack("<I", self.periph_value)[:size])
+
+    def call(self, name, *args):
+        """Run an algo function, return (return value or None on timeout, instruction count)"""
+        regs = self._regs
+        for reg, value in zip((regs.UC_ARM_REG_R0, regs.UC_ARM_REG_R1, regs.UC_ARM_REG_R2, regs.UC_ARM_REG_R3), args):
+            self.mu.reg_write(reg, value)
+        self.mu.reg_write(regs.UC_ARM_REG_R9, self.static_base)
+        self.mu.reg_write(regs.UC_ARM_REG_SP, self.stack_pointer)
+        # Return to the bkpt of the blob header
+        self.mu.reg_write(regs.UC_ARM_REG_LR, self.entry + 1)
+        self.instructions = 0
+        start = self.entry + HEADER_SIZE + self.algo.symbols[name]
+        try:
+            self.mu.emu_start(start | 1, self.entry)
+        except self._uc.UcError as err:
+            print(f"{name}: {err} at {self.mu.reg_read(regs.UC_ARM_REG_PC):#010x}")
+            return None, self.instructions
+        if self.mu.reg_read(regs.UC_ARM_REG_PC) != self.entry:
+            return None, self.instructions
+        return self.mu.reg_read(regs.UC_ARM_REG_R0), self.instructions
+
+    def program(self, addr, size):
+        """Program a test pattern, return (success, instruction count)"""
+        data = bytes((i * 7 + size) & 0xFF for i in range(size))
+        self.mu.mem_write(self.stack_pointer, data)
+        result, instructions = self.call('ProgramPage', addr, size, self.stack_pointer)
+        written = bytes(self.mu.mem_read(addr, size)) == data
+        return (result == 0 and written), instructions
+
+def profile(algo, profiler, max_buffer_size):
+    """
+    Print instruction counts of the main algo functions and return the program
+    buffer size that needs the fewest ProgramPage calls per sector
+
+    The flash model is plain memory, so a multi-page size that "works" here
+    can still fail on flash with a page latch. It is only a suggestion.
+    """
+    flash_start = algo.flash_start
+    sector_size = algo.sector_sizes[0][1]
+    page_size = algo.page_size
+
+    print("\nProfile (instructions):")
+    for name, args in (('Init', (flash_start, 0, 1)),
+                       ('EraseSector', (flash_start,)),
+                       ('UnInit', (1,)),
+                       ('Init', (flash_start, 0, 2))):
+        result, instructions = profiler.call(name, *args)
+        status = "timeout" if result is None else f"returned {result:#x}"
+        print(f"{name}:{' ' * (11 - len(name))} {instructions:10d} ({status})")
+
+    ok, instructions = profiler.program(flash_start, page_size)
+    print(f"ProgramPage: {instructions:10d} ({page_size:#x} bytes, {'ok' if ok else 'data not written'})")
+    if not ok:
+        print("Flash model could not confirm programming, keeping one page per call")
+        return page_size
+
+    # Fewest calls per sector with the smallest buffer that achieves it
+    largest = min(sector_size, max_buffer_size) // page_size * page_size
+    if largest <= page_size:
+        return page_size
+    calls = (sector_size + largest - 1) // largest
+    candidate = ((sector_size + calls - 1) // calls + page_size - 1) // page_size * page_size
+
+    # Only use it if ProgramPage handles more than a page per call
+    offset = sector_size if algo.flash_size > sector_size else 0
+    ok, instructions = profiler.program(flash_start + offset, candidate)
+    print(f"ProgramPage: {instructions:10d} ({candidate:#x} bytes, {'ok' if ok else 'data not written'})")
+    if not ok:
+        return page_size
+    print(f"Suggested program buffer: {candidate:#x} bytes, {calls} call(s) per {sector_size:#x} byte sector")
+    return candidate
+
 class PackFlashAlgoGenerator(PackFlashAlgo):
     """
     Class to wrap a flash algo
@@ -207,8 +344,22 @@ def main():
     parser.add_argument("-t", "--template", help="Path to Jinja template file (default is an internal "
                         "template for DAPLink).")
     parser.add_argument('-c', '--copyright', help="Set copyright owner.")
+    parser.add_argument("-p", "--profile", action="store_true", help="Run the algo in an emulator and report "
+                        "instruction counts (needs the unicorn package).")
+    parser.add_argument("--ram-end", default=None, type=str_to_num, help="End of the target RAM region. With "
+                        "--profile the largest program buffer that fits is suggested if the algo supports it.")
+    parser.add_argument("--use-program-buffer", action="store_true", help="Write the program buffer suggested "
+                        "by --profile into the blob. Only use it once ProgramPage is known to handle more than one "
+                        "page per call on the real flash, the emulated flash has no page latch.")
+    parser.add_argument("--periph-value", default=PROFILE_PERIPHERAL_VALUE, type=str_to_num, help="Value read "
+                        f"from any peripheral register with --profile (default {PROFILE_PERIPHERAL_VALUE:#x}).")
+    parser.add_argument("--max-instructions", default=PROFILE_MAX_INSTRUCTIONS, type=str_to_num, help="Instruction "
+                        f"limit per function with --profile (default {PROFILE_MAX_INSTRUCTIONS}).")
     args = parser.parse_args()
 
+    if args.use_program_buffer and not args.profile:
+        parser.error("--use-program-buffer needs --profile")
+
     if not args.copyright:
         print(f"{colorama.Fore.YELLOW}Warning! No copyright owner was specified. Defaulting to \"Arm Limited\". "
             f"Please set via --copyright, or edit output.{colorama.Style.RESET_ALL}")
@@ -236,6 +387,21 @@ def main():
         else:
             sp = (sp + 255) // 256 * 256
 
+        program_buffer_size = algo.page_size
+        if args.profile:
+            static_base = args.blob_start + HEADER_SIZE + algo.rw_start
+            max_buffer_size = algo.page_size
+            if args.ram_end is not None:
+                max_buffer_size = max(args.ram_end - sp, algo.page_size)
+            profiler = FlashAlgoProfiler(algo, args.blob_start, static_base, sp,
+                                         args.periph_value, args.max_instructions)
+            suggested_size = profile(algo, profiler, max_buffer_size)
+            if args.use_program_buffer:
+                program_buffer_size = suggested_size
+            elif suggested_size != algo.page_size:
+                print("Not used, keeping one page per call. Pass --use-program-buffer to use it.")
+            print()
+
         print(f"load addr:   {args.blob_start:#010x}")
         print(f"header:      {HEADER_SIZE:#x} bytes")
         print(f"data:        {len(algo.algo_data):#x} bytes")
@@ -243,7 +409,7 @@ def main():
         print(f"rw:          {algo.rw_start:#010x} + {algo.rw_size:#x} bytes")
         print(f"zi:          {algo.zi_start:#010x} + {algo.zi_size:#x} bytes")
         print(f"stack:       {stack_base:#010x} .. {sp:#010x} ({sp - stack_base:#x} bytes)")
-        print(f"buffer:      {sp:#010x} .. {sp + algo.page_size:#010x} ({algo.page_size:#x} bytes)")
+        print(f"buffer:      {sp:#010x} .. {sp + program_buffer_size:#010x} ({program_buffer_size:#x} bytes)")
 
         print("\nSymbol offsets:")
         for n, v in sorted(algo.symbols.items(), key=lambda x: x[1]):
@@ -282,6 +448,7 @@ def main():
             'header_size': HEADER_SIZE,
             'entry': args.blob_start,
             'stack_pointer': sp,
+            'program_buffer_size': program_buffer_size,
             'year': datetime.now().year if args.copyright else ("2009-%d" % datetime.now().year),
             'copyright_owner': args.copyright or "Arm Limited, All Rights Reserved",
         }
@@ -210,8 +210,9 @@ def post_build_script(input_file, output_file, board_id=None, family_id=None, bi
     data = list(bytearray(data))
     output_data = ('static const unsigned int image_start = 0x%08x;\n'
                     'static const unsigned int image_size = 0x%08x;\n'
+                    'static const unsigned int image_crc = 0x%08x;\n'
                     'static const char image_data[0x%08x] = {\n    ' %
-                    (start, size, size))
+                    (start, size, crc32, size))
     for i, byte_val in enumerate(data):
         output_data += '0x%02x' % byte_val + ', '
         if ((i + 1) % 0x20) == 0: